@@ -1,19 +1,25 @@
-// Maestro–trabajadores con subprefijos de 2 dígitos (a–z,0–9)
+// Maestro–trabajadores con subprefijos de profundidad variable (a–z,0–9)
 // El maestro reparte tareas, y los trabajadores buscan coincidencias con debug opcional.
-// Compilar:  mpicc -O3 -std=c11 -Wall -Wextra -o algoritmo_mpi algoritmo_mpi.c
+// Compilar:  mpicc -O3 -std=c11 -pthread -Wall -Wextra -o algoritmo_mpi algoritmo_mpi.c
 // Ejecutar:  mpirun -np 4 ./algoritmo_mpi
 
 #include <mpi.h>
+#include <limits.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 static const char DIGITS[] = "abcdefghijklmnopqrstuvwxyz0123456789";
 static const int RADIX = 36;
-typedef enum { STRAT_CONTIG = 0, STRAT_SHUFFLE = 1 } Strategy;
+#define MAX_DEPTH 4   // la tabla de cortes de objetivos tiene 36^depth+1 entradas
+#define MAX_LEN 12    // 36^13 no entra en 64 bits
+typedef enum { STRAT_CONTIG = 0, STRAT_SHUFFLE = 1, STRAT_SHUFFLE_ALL = 2 } Strategy;
+typedef enum { PRED_INDEX = 0, PRED_HOSTSET = 1 } PredKind;
+typedef enum { OUT_CSV = 0, OUT_BIN = 1 } OutFormat;
 
 
 // ---------------- Configuración ----------------
@@ -30,6 +36,20 @@ typedef struct {
     uint64_t progress_step;   // cada cuántos intentos imprimir progreso (default 5e6)
 
     Strategy strategy;
+    uint64_t batch;           // subprefijos por asignación (0 = guiado)
+    int master_work;          // 1: los maestros también recorren subprefijos (hilo ayudante)
+    int hier;                 // 1: raíz + un sub-maestro por nodo
+    int hier_group;           // ranks por grupo con --hier (0 = por nodo)
+    int depth;                // caracteres fijos por subprefijo (0 = automático)
+    int steal;                // 1: los trabajadores sin lote roban la mitad de otro rango
+    PredKind predicate;       // cómo se decide si un hostname es objetivo
+    const char* hosts;        // lista de hostnames (una por línea) para el predicado hostset
+    double cancel_ms;         // latencia objetivo de STOP/STEAL en el barrido (0 = consultar cada lote)
+    double straggler;         // re-emitir una tarea que tarda más de X veces la mediana (0 = nunca)
+    const char* metrics;      // JSON con métricas por rank (NULL = no)
+    const char* trace;        // timeline Chrome/Perfetto (NULL = no)
+    const char* out;          // archivo de hallazgos (NULL = por stdout)
+    OutFormat out_format;
 } Config;
 
 static void die(const char* msg) {
@@ -56,23 +76,59 @@ static uint64_t splitmix64(uint64_t *x) {
     return z ^ (z >> 31);
 }
 
-static uint64_t* make_targets(uint64_t total, int n_live, uint64_t seed) {
-    if (n_live <= 0) return NULL;
-    uint64_t* T = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)n_live);
-    if (!T) die("malloc targets");
+// ---------------- Conjunto de objetivos ----------------
+// Objetivos ordenados + tabla de cortes por subprefijo: los objetivos del
+// subprefijo sp son idx[start[sp] .. start[sp+1]). Un trabajador solo mira los
+// de su rango y avanza un puntero (O(1) por candidato, sin importar n_live).
+typedef struct {
+    uint64_t* idx;      // objetivos ordenados
+    uint64_t* start;    // nsub+1 cortes
+    uint64_t nsub;
+    uint64_t per;       // candidatos por subprefijo
+    int n;
+} TargetSet;
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Misma secuencia de sorteos que antes (mismos objetivos para la misma seed), pero
+// el descarte de repetidos usa un hash abierto: O(n) en vez de O(n²).
+static void make_targets(TargetSet* ts, uint64_t total, int n_live, uint64_t seed, uint64_t nsub) {
+    memset(ts, 0, sizeof(*ts));
+    ts->nsub = nsub;
+    ts->per = total / nsub;
+    ts->start = (uint64_t*)calloc((size_t)nsub + 1, sizeof(uint64_t));
+    if (!ts->start) die("malloc targets");
+    if (n_live <= 0) return;
+    if ((uint64_t)n_live > total) die("--n_live mayor que el espacio de búsqueda");
+
+    uint64_t cap = 16;
+    while (cap < 2 * (uint64_t)n_live) cap <<= 1;
+    uint64_t* h = (uint64_t*)calloc((size_t)cap, sizeof(uint64_t));   // idx+1, 0 = vacío
+    ts->idx = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)n_live);
+    if (!h || !ts->idx) die("malloc targets");
+
     uint64_t s = seed ? seed : 1;
     for (int k = 0; k < n_live; ) {
         uint64_t cand = splitmix64(&s) % total;
-        int ok = 1;
-        for (int j = 0; j < k; ++j) if (T[j] == cand) { ok = 0; break; }
-        if (ok) T[k++] = cand;
+        uint64_t x = cand + 1, j = (cand * 0x9E3779B97F4A7C15ULL) & (cap - 1);
+        while (h[j] && h[j] != x) j = (j + 1) & (cap - 1);
+        if (!h[j]) { h[j] = x; ts->idx[k++] = cand; }
     }
-    return T;
+    free(h);
+    ts->n = n_live;
+
+    qsort(ts->idx, (size_t)n_live, sizeof(uint64_t), cmp_u64);
+    for (int i = 0; i < n_live; ++i) ts->start[ts->idx[i] / ts->per + 1]++;
+    for (uint64_t sp = 0; sp < nsub; ++sp) ts->start[sp + 1] += ts->start[sp];
 }
 
-static int is_target(uint64_t idx, const uint64_t* T, int n_live) {
-    for (int i = 0; i < n_live; ++i) if (T[i] == idx) return 1;
-    return 0;
+static void free_targets(TargetSet* ts) {
+    free(ts->idx);
+    free(ts->start);
+    memset(ts, 0, sizeof(*ts));
 }
 
 // idx → string base36 de longitud fija
@@ -84,19 +140,6 @@ static void index_to_base36(uint64_t idx, int len, char* out) {
     out[len] = '\0';
 }
 
-static void subprefix_id_to_chars(uint64_t sp_id, char *c0, char *c1) {
-    *c1 = DIGITS[sp_id % RADIX];
-    sp_id /= RADIX;
-    *c0 = DIGITS[sp_id % RADIX];
-}
-
-static void print_found(int rank, const char* prefix, int len, uint64_t idx) {
-    char suf[64];
-    index_to_base36(idx, len, suf);
-    printf("[rank %d] FOUND: %s%s (idx=%" PRIu64 ")\n", rank, prefix, suf, idx);
-    fflush(stdout);
-}
-
 // ---------------- CLI ----------------
 static void parse_args(int argc, char** argv, Config* cfg) {
     cfg->prefix = "host-A-";
@@ -110,6 +153,20 @@ static void parse_args(int argc, char** argv, Config* cfg) {
     cfg->progress_step = 5000000ULL;
 
     cfg->strategy = STRAT_CONTIG;
+    cfg->batch = 0;
+    cfg->master_work = 0;
+    cfg->hier = 0;
+    cfg->hier_group = 0;
+    cfg->depth = 0;
+    cfg->steal = 1;
+    cfg->predicate = PRED_INDEX;
+    cfg->hosts = NULL;
+    cfg->cancel_ms = 1.0;
+    cfg->straggler = 4.0;
+    cfg->metrics = NULL;
+    cfg->trace = NULL;
+    cfg->out = NULL;
+    cfg->out_format = OUT_CSV;
 
     for (int i = 1; i < argc; ++i) {
         if (!strcmp(argv[i], "--prefix") && i+1 < argc) cfg->prefix = argv[++i];
@@ -120,230 +177,1708 @@ static void parse_args(int argc, char** argv, Config* cfg) {
         else if (!strcmp(argv[i], "--print_targets") && i+1 < argc) cfg->print_targets = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--debug") && i+1 < argc) cfg->debug = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--progress_step") && i+1 < argc) cfg->progress_step = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--batch") && i+1 < argc) cfg->batch = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--master_work") && i+1 < argc) cfg->master_work = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hier") && i+1 < argc) cfg->hier = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hier_group") && i+1 < argc) cfg->hier_group = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--depth") && i+1 < argc) cfg->depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--steal") && i+1 < argc) cfg->steal = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--cancel_ms") && i+1 < argc) cfg->cancel_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--straggler") && i+1 < argc) cfg->straggler = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--metrics") && i+1 < argc) cfg->metrics = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i+1 < argc) cfg->trace = argv[++i];
+        else if (!strcmp(argv[i], "--out") && i+1 < argc) cfg->out = argv[++i];
+        else if (!strcmp(argv[i], "--out_format") && i+1 < argc) {
+            const char* s = argv[++i];
+            if (!strcmp(s, "csv"))      cfg->out_format = OUT_CSV;
+            else if (!strcmp(s, "bin")) cfg->out_format = OUT_BIN;
+            else die("valor de --out_format inválido (use 'csv' o 'bin')");
+        }
+        else if (!strcmp(argv[i], "--hosts") && i+1 < argc) { cfg->hosts = argv[++i]; cfg->predicate = PRED_HOSTSET; }
+        else if (!strcmp(argv[i], "--predicate") && i+1 < argc) {
+            const char* s = argv[++i];
+            if (!strcmp(s, "index"))        cfg->predicate = PRED_INDEX;
+            else if (!strcmp(s, "hostset")) cfg->predicate = PRED_HOSTSET;
+            else die("valor de --predicate inválido (use 'index' o 'hostset')");
+        }
         else if (!strcmp(argv[i], "--strategy") && i+1 < argc) {
             const char* s = argv[++i];
             if (!strcmp(s, "contig"))      cfg->strategy = STRAT_CONTIG;
             else if (!strcmp(s, "shuffle")) cfg->strategy = STRAT_SHUFFLE;
-            else die("valor de --strategy inválido (use 'contig' o 'shuffle')");
+            else if (!strcmp(s, "shuffle_all")) cfg->strategy = STRAT_SHUFFLE_ALL;
+            else die("valor de --strategy inválido (use 'contig', 'shuffle' o 'shuffle_all')");
         }
     }
-    if (cfg->len < 2) die("--len debe ser >= 2");
+    if (cfg->len < 2 || cfg->len > MAX_LEN) die("--len debe estar entre 2 y 12");
     if (cfg->n_live < 0) die("--n_live debe ser >= 0");
+    if (cfg->hier_group < 0) die("--hier_group debe ser >= 0");
+    if (cfg->straggler < 0) die("--straggler debe ser >= 0");
+    if (cfg->depth < 0 || cfg->depth > cfg->len || cfg->depth > MAX_DEPTH)
+        die("--depth debe estar entre 0 y min(--len, 4)");
+}
+
+// ---------------- Candidatos y predicados ----------------
+// Los trabajadores materializan los hostnames (prefijo+sufijo) de a lotes de
+// CAND_BATCH en un buffer contiguo: el prefijo se escribe una sola vez al crear el
+// buffer y los sufijos salen de un odómetro base 36 (acarreo en vez de div/mod por
+// candidato). Cada lote pasa por un predicado enchufable.
+#define CAND_BATCH 256
+#define SUFFIX_SLOT 16   // bytes reservados al sufijo: se copia siempre el slot entero (memcpy fijo)
+
+typedef struct {
+    int len;
+    uint8_t dig[MAX_LEN];
+    char s[SUFFIX_SLOT];    // sufijo + NULs hasta el final del slot
+} Odometer;
+
+static void od_set(Odometer* od, int len, uint64_t idx) {
+    od->len = len;
+    memset(od->s, 0, sizeof(od->s));
+    for (int i = len - 1; i >= 0; --i) {
+        od->dig[i] = (uint8_t)(idx % RADIX);
+        od->s[i] = DIGITS[od->dig[i]];
+        idx /= RADIX;
+    }
+}
+
+static void od_next(Odometer* od) {
+    int i = od->len - 1;
+    while (i > 0 && od->dig[i] == RADIX - 1) { od->dig[i] = 0; od->s[i] = DIGITS[0]; --i; }
+    od->dig[i] = (uint8_t)((od->dig[i] + 1) % RADIX);
+    od->s[i] = DIGITS[od->dig[i]];
+}
+
+typedef struct {
+    uint64_t first;     // índice del primer candidato
+    const uint64_t* idx; // índices de cada candidato (NULL = consecutivos desde first)
+    int n;              // candidatos en el lote
+    int plen, slen;     // largo del prefijo y del sufijo
+    int stride;         // bytes por hostname en text (prefijo + SUFFIX_SLOT)
+    char* text;         // CAND_BATCH hostnames NUL-terminados (NULL si el predicado no los usa)
+} CandBatch;
+
+static void batch_init(CandBatch* b, const Config* cfg, int with_text) {
+    memset(b, 0, sizeof(*b));
+    if (!with_text) return;
+    b->plen = (int)strlen(cfg->prefix);
+    b->slen = cfg->len;
+    b->stride = b->plen + SUFFIX_SLOT;
+    b->text = (char*)calloc(CAND_BATCH, (size_t)b->stride);
+    if (!b->text) die("malloc lote de candidatos");
+    for (int i = 0; i < CAND_BATCH; ++i) memcpy(b->text + (size_t)i * b->stride, cfg->prefix, (size_t)b->plen);
+}
+
+// Sufijos de los candidatos [first, first+n), consecutivos
+static void batch_fill(CandBatch* b, int len, uint64_t first, int n) {
+    b->first = first; b->idx = NULL; b->n = n;
+    if (!b->text) return;
+    Odometer od;
+    od_set(&od, len, first);
+    for (int i = 0; i < n; ++i) {
+        memcpy(b->text + (size_t)i * b->stride + b->plen, od.s, SUFFIX_SLOT);
+        od_next(&od);
+    }
+}
+
+// Sufijos de candidatos sueltos (orden SHUFFLE_ALL): sin odómetro
+static void batch_fill_list(CandBatch* b, int len, const uint64_t* idx, int n) {
+    b->first = idx[0]; b->idx = idx; b->n = n;
+    if (!b->text) return;
+    for (int i = 0; i < n; ++i) index_to_base36(idx[i], len, b->text + (size_t)i * b->stride + b->plen);
+}
+
+// Conjunto de hostnames: hash abierto de FNV-1a 64 sobre el string completo, con
+// un filtro de 1 bit por hash (>= 64 bits por host) delante: casi todos los
+// candidatos se descartan con un bit en cache y un salto predecible, sin sondear.
+typedef struct {
+    uint64_t* hash;     // 0 = vacío
+    uint32_t* off;      // offset del string en arena
+    uint64_t mask;
+    uint64_t* filt;
+    uint64_t fmask;     // bits del filtro - 1
+    char* arena;
+    uint64_t n;
+} HostSet;
+
+static const uint64_t FNV_OFF = 14695981039346656037ULL, FNV_PRIME = 1099511628211ULL;
+
+static uint64_t fnv1a(uint64_t h, const char* s, size_t n) {
+    for (size_t i = 0; i < n; ++i) { h ^= (uint8_t)s[i]; h *= FNV_PRIME; }
+    return h;
+}
+
+// arena: strings NUL-terminados (n en total); el HostSet se queda con ella
+static void hostset_build(HostSet* hs, char* arena, size_t size, uint64_t n) {
+    memset(hs, 0, sizeof(*hs));
+    uint64_t cap = 16;
+    while (cap < 2 * n) cap <<= 1;
+    hs->hash = (uint64_t*)calloc((size_t)cap, sizeof(uint64_t));
+    hs->off = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)cap);
+    if (!hs->hash || !hs->off) die("malloc hostset");
+    if (size > UINT32_MAX) die("lista de hostnames demasiado grande");
+    hs->mask = cap - 1;
+    uint64_t fbits = 4096;
+    while (fbits < 64 * n) fbits <<= 1;
+    hs->filt = (uint64_t*)calloc((size_t)(fbits / 64), sizeof(uint64_t));
+    if (!hs->filt) die("malloc hostset");
+    hs->fmask = fbits - 1;
+    hs->arena = arena;
+    for (size_t o = 0; o < size; o += strlen(arena + o) + 1) {
+        if (!arena[o]) continue;
+        uint64_t h = fnv1a(FNV_OFF, arena + o, strlen(arena + o));
+        if (!h) h = 1;
+        uint64_t j = h & hs->mask;
+        int dup = 0;
+        while (hs->hash[j] && !(dup = hs->hash[j] == h && !strcmp(arena + hs->off[j], arena + o)))
+            j = (j + 1) & hs->mask;
+        if (dup) continue;
+        hs->hash[j] = h; hs->off[j] = (uint32_t)o; hs->n++;
+        const uint64_t fb = (h >> 24) & hs->fmask;
+        hs->filt[fb >> 6] |= 1ULL << (fb & 63);
+    }
+}
+
+static inline int hostset_maybe(const HostSet* hs, uint64_t h) {
+    if (!h) h = 1;
+    const uint64_t fb = (h >> 24) & hs->fmask;
+    return (int)((hs->filt[fb >> 6] >> (fb & 63)) & 1);
+}
+
+static int hostset_has(const HostSet* hs, uint64_t h, const char* s) {
+    if (!h) h = 1;
+    for (uint64_t j = h & hs->mask; hs->hash[j]; j = (j + 1) & hs->mask)
+        if (hs->hash[j] == h && !strcmp(hs->arena + hs->off[j], s)) return 1;
+    return 0;
+}
+
+static void hostset_free(HostSet* hs) {
+    free(hs->hash); free(hs->off); free(hs->filt); free(hs->arena);
+    memset(hs, 0, sizeof(*hs));
+}
+
+// Predicado: marca qué candidatos del lote son objetivos. Devuelve cuántos y deja
+// sus posiciones (crecientes) en hit[].
+typedef struct Predicate {
+    const char* name;
+    int needs_text;
+    int (*test)(const struct Predicate* p, const CandBatch* b, int* hit);
+    const TargetSet* ts;    // index
+    HostSet hs;             // hostset
+    uint64_t prefix_h;      // FNV del prefijo (los sufijos siguen desde acá)
+} Predicate;
+
+static const uint64_t* lower_bound_u64(const uint64_t* a, const uint64_t* e, uint64_t x) {
+    while (a < e) {
+        const uint64_t* m = a + (e - a) / 2;
+        if (*m < x) a = m + 1; else e = m;
+    }
+    return a;
+}
+
+// index: compara índices contra los objetivos simulados (sin materializar strings)
+static int pred_index_test(const Predicate* p, const CandBatch* b, int* hit) {
+    const TargetSet* ts = p->ts;
+    if (b->idx) {
+        int k = 0;
+        for (int i = 0; i < b->n; ++i) {
+            const uint64_t sp = b->idx[i] / ts->per;
+            const uint64_t* e = ts->idx + ts->start[sp + 1];
+            const uint64_t* t = lower_bound_u64(ts->idx + ts->start[sp], e, b->idx[i]);
+            if (t < e && *t == b->idx[i]) hit[k++] = i;
+        }
+        return k;
+    }
+    const uint64_t sp = b->first / ts->per;
+    const uint64_t* e = ts->idx + ts->start[sp + 1];
+    const uint64_t* t = lower_bound_u64(ts->idx + ts->start[sp], e, b->first);
+    int k = 0;
+    for (; t < e && *t < b->first + (uint64_t)b->n; ++t) hit[k++] = (int)(*t - b->first);
+    return k;
+}
+
+// hostset: busca cada hostname materializado en el conjunto
+// El FNV va carácter por carácter para todo el lote: son CAND_BATCH cadenas de
+// multiplicaciones independientes que el compilador intercala (o vectoriza).
+static int pred_hostset_test(const Predicate* p, const CandBatch* b, int* hit) {
+    uint64_t h[CAND_BATCH];
+    const int n = b->n, stride = b->stride;
+    const size_t slen = (size_t)b->slen;
+    const uint8_t* t = (const uint8_t*)b->text + b->plen;
+    for (int i = 0; i < n; ++i) h[i] = p->prefix_h;
+    for (size_t c = 0; c < slen; ++c)
+        for (int i = 0; i < n; ++i) h[i] = (h[i] ^ t[(size_t)i * stride + c]) * FNV_PRIME;
+    int k = 0;
+    for (int i = 0; i < n; ++i)
+        if (hostset_maybe(&p->hs, h[i]) && hostset_has(&p->hs, h[i], b->text + (size_t)i * stride)) hit[k++] = i;
+    return k;
+}
+
+// Conjunto de hostnames: el archivo --hosts (una línea por host, lo lee rank 0 y
+// lo reparte) o, si no hay, los objetivos simulados escritos como hostnames
+static void pred_load_hosts(Predicate* p, const Config* cfg, const TargetSet* ts) {
+    int rank; MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    char* arena = NULL;
+    uint64_t size = 0, n = 0;
+    if (cfg->hosts) {
+        if (rank == 0) {
+            FILE* f = fopen(cfg->hosts, "rb");
+            if (!f) die("no se pudo abrir --hosts");
+            fseek(f, 0, SEEK_END);
+            const long end = ftell(f);
+            if (end < 0) die("lectura de --hosts");
+            // se reparte con un solo MPI_Bcast (cuenta int): se corta antes de mandar el tamaño
+            if ((uint64_t)end + 1 > INT_MAX) die("lista de hostnames demasiado grande");
+            size = (uint64_t)end + 1;
+            fseek(f, 0, SEEK_SET);
+            arena = (char*)malloc((size_t)size);
+            if (!arena || fread(arena, 1, (size_t)size - 1, f) != size - 1) die("lectura de --hosts");
+            fclose(f);
+            arena[size - 1] = '\0';
+        }
+        MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        if (rank != 0 && !(arena = (char*)malloc((size_t)size))) die("malloc --hosts");
+        MPI_Bcast(arena, (int)size, MPI_CHAR, 0, MPI_COMM_WORLD);
+        for (uint64_t i = 0; i < size; ++i)
+            if (arena[i] == '\n' || arena[i] == '\r') arena[i] = '\0';
+        for (uint64_t i = 0; i < size; ++i) n += arena[i] && (i == 0 || !arena[i - 1]);
+    } else {
+        const size_t plen = strlen(cfg->prefix), w = plen + (size_t)cfg->len + 1;
+        size = (uint64_t)ts->n * w;
+        n = (uint64_t)ts->n;
+        arena = (char*)malloc(size ? (size_t)size : 1);
+        if (!arena) die("malloc hostset");
+        for (int i = 0; i < ts->n; ++i) {
+            memcpy(arena + i * w, cfg->prefix, plen);
+            index_to_base36(ts->idx[i], cfg->len, arena + i * w + plen);
+        }
+    }
+    hostset_build(&p->hs, arena, (size_t)size, n);
+}
+
+static void make_predicate(Predicate* p, const Config* cfg, const TargetSet* ts) {
+    memset(p, 0, sizeof(*p));
+    p->ts = ts;
+    if (cfg->predicate == PRED_HOSTSET) {
+        p->name = "hostset";
+        p->needs_text = 1;
+        p->test = pred_hostset_test;
+        p->prefix_h = fnv1a(FNV_OFF, cfg->prefix, strlen(cfg->prefix));
+        pred_load_hosts(p, cfg, ts);
+    } else {
+        p->name = "index";
+        p->test = pred_index_test;
+    }
+}
+
+static void free_predicate(Predicate* p) {
+    hostset_free(&p->hs);
+}
+
+// ---------------- Orden (permutación con clave) ----------------
+// Red de Feistel balanceada sobre [0, 2^bits) (bits par, 2^bits < 4n) con
+// cycle-walking: se vuelve a cifrar mientras el resultado caiga fuera de [0, n).
+// Es una biyección de [0, n) que se evalúa en O(1) sin tabla, así que sirve igual
+// para 36^depth subprefijos que para los 36^len candidatos.
+#define FEISTEL_ROUNDS 6
+
+typedef struct {
+    uint64_t n;
+    int half;
+    uint64_t mask;
+    uint64_t key[FEISTEL_ROUNDS];
+} Perm;
+
+static void perm_init(Perm* P, uint64_t n, uint64_t seed) {
+    int bits = 2;
+    while (bits < 64 && (1ULL << bits) < n) ++bits;
+    bits += bits & 1;
+    P->n = n;
+    P->half = bits / 2;
+    P->mask = (1ULL << P->half) - 1;
+    uint64_t s = (seed ? seed : 1) ^ 0x243F6A8885A308D3ULL;   // otra secuencia que la de los objetivos
+    for (int i = 0; i < FEISTEL_ROUNDS; ++i) P->key[i] = splitmix64(&s);
+}
+
+static inline uint64_t feistel_f(uint64_t r, uint64_t k) {
+    r ^= k;
+    r = (r ^ (r >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    r = (r ^ (r >> 27)) * 0x94D049BB133111EBULL;
+    return r ^ (r >> 31);
+}
+
+static inline uint64_t perm_apply(const Perm* P, uint64_t x) {
+    do {
+        uint64_t L = x >> P->half, R = x & P->mask;
+        for (int i = 0; i < FEISTEL_ROUNDS; ++i) {
+            uint64_t t = L ^ (feistel_f(R, P->key[i]) & P->mask);
+            L = R; R = t;
+        }
+        x = (L << P->half) | R;
+    } while (x >= P->n);
+    return x;
+}
+
+// Orden de la secuencia: CONTIG (pos == id), SHUFFLE (subprefijos permutados,
+// cada uno recorrido en orden) o SHUFFLE_ALL (cada posición es un candidato
+// permutado). Todos los ranks arman la misma permutación a partir de --seed.
+typedef struct {
+    Strategy strategy;
+    Perm perm;
+} Order;
+
+static void make_order(Order* o, const Config* cfg) {
+    memset(o, 0, sizeof(*o));
+    o->strategy = cfg->strategy;
+    if (cfg->strategy == STRAT_SHUFFLE) perm_init(&o->perm, powu(RADIX, cfg->depth), cfg->seed);
+    else if (cfg->strategy == STRAT_SHUFFLE_ALL) perm_init(&o->perm, powu(RADIX, cfg->len), cfg->seed);
+}
+
+// Subprefijo en la posición p del orden (SHUFFLE_ALL: el bloque de posiciones p)
+static uint64_t order_unit(const Order* o, uint64_t p) {
+    return o->strategy == STRAT_SHUFFLE ? perm_apply(&o->perm, p) : p;
+}
+
+// ---------------- Métricas ----------------
+// Cada hilo (maestro, trabajador, ayudante) tiene su propio Metrics: contadores,
+// tiempos y, con --trace, un buffer de eventos. Nadie más lo toca hasta el final,
+// así que no hay locks ni printf en el camino caliente. Al terminar se juntan en
+// rank 0 (MPI_Gatherv) y se exportan como JSON (--metrics) y como timeline de
+// Chrome/Perfetto (--trace).
+#define METRICS(X)                                                             \
+    X(candidates)     /* hostnames evaluados */                                \
+    X(tasks)          /* asignaciones válidas recibidas */                     \
+    X(hits)           /* objetivos encontrados */                              \
+    X(steals)         /* rangos cedidos (trabajador) o robos hechos (maestro) */ \
+    X(compute_s)      /* recorriendo candidatos */                             \
+    X(wait_assign_s)  /* bloqueado esperando un ASSIGN */                      \
+    X(idle_s)         /* maestro: en MPI_Waitany; trabajador: sin computar */  \
+    X(msgs)           /* mensajes atendidos por el maestro */                  \
+    X(dispatch_s)     /* maestro: atendiendo mensajes */                       \
+    X(dispatch_max_s) /* maestro: el mensaje que más tardó */                 \
+    X(covered)        /* maestro: candidatos recorridos por alguna copia */    \
+    X(wasted)         /* maestro: candidatos recorridos dos veces */           \
+    X(reissued)       /* maestro: tareas re-emitidas a otro trabajador */      \
+    X(cancelled)      /* maestro: copias canceladas por terminar la otra */
+
+#define X_ENUM(name) M_##name,
+enum { METRICS(X_ENUM) M_COUNT };
+#undef X_ENUM
+#define X_NAME(name) #name,
+static const char* const METRIC_NAME[M_COUNT] = { METRICS(X_NAME) };
+#undef X_NAME
+
+enum { ROLE_WORKER = 0, ROLE_MASTER = 1, ROLE_SUBMASTER = 2 };
+static const char* const ROLE_NAME[] = { "worker", "master", "sub-master" };
+
+// Eventos del timeline: spans (scan, wait_assign, dispatch) o instantáneos (steal,
+// stop, reissue, cancel); EV_ARG nombra sus dos argumentos
+enum { EV_SCAN, EV_WAIT, EV_DISPATCH, EV_STEAL, EV_STOP, EV_REISSUE, EV_CANCEL };
+static const char* const EV_NAME[] = { "scan", "wait_assign", "dispatch", "steal", "stop", "reissue", "cancel" };
+static const char* const EV_ARG[][2] = {
+    { "first", "count" }, { "first", "count" }, { "tag", "from" }, { "victim", "thief" },
+    { "first", "count" }, { "lease", "to" }, { "lease", "rank" }
+};
+#define EV_MAX (1u << 18)   // por hilo; los que sobran se cuentan en 'dropped'
+
+typedef struct {
+    double ts, dur;         // segundos desde el inicio común (dur < 0 = instantáneo)
+    uint64_t a, b;          // argumentos según el tipo
+    int32_t pid, tid, kind, pad;
+} Event;
+
+typedef struct {
+    int32_t rank, tid, role, pad;
+    double v[M_COUNT];
+    uint64_t nev, dropped;
+} MetRec;
+
+typedef struct {
+    MetRec rec;
+    Event* ev;
+    size_t cap;
+    int trace;
+    double t0;
+} Metrics;
+
+static void met_init(Metrics* m, int rank, int tid, int role, int trace, double t0) {
+    memset(m, 0, sizeof(*m));
+    m->rec.rank = rank; m->rec.tid = tid; m->rec.role = role;
+    m->trace = trace;
+    m->t0 = t0;
+}
+
+// t y dur en segundos de MPI_Wtime (dur < 0 = instantáneo)
+static void met_event(Metrics* m, int kind, double t, double dur, uint64_t a, uint64_t b) {
+    if (!m->trace) return;
+    if (m->rec.nev == m->cap) {
+        if (m->cap == EV_MAX) { m->rec.dropped++; return; }
+        m->cap = m->cap ? 2 * m->cap : 1024;
+        if (!(m->ev = (Event*)realloc(m->ev, m->cap * sizeof(Event)))) die("malloc eventos");
+    }
+    Event* e = &m->ev[m->rec.nev++];
+    e->ts = t - m->t0; e->dur = dur; e->a = a; e->b = b;
+    e->pid = m->rec.rank; e->tid = m->rec.tid; e->kind = kind; e->pad = 0;
+}
+
+// Junta en rank 0 los registros (1 o 2 por proceso) y, con trace, los eventos.
+// Devuelve en rank 0 los arreglos (el llamador los libera); *nrec/*nev = cantidades.
+static void met_gather(Metrics* const* ms, int nm, int trace, MetRec** recs, int* nrec, Event** evs, uint64_t* nev) {
+    int rank, world;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world);
+
+    MetRec mine[2];
+    int myev = 0;
+    for (int i = 0; i < nm; ++i) { mine[i] = ms[i]->rec; myev += (int)ms[i]->rec.nev; }
+
+    int* cnt = NULL, *dsp = NULL;
+    if (rank == 0) {
+        cnt = (int*)malloc(sizeof(int) * (size_t)world);
+        dsp = (int*)malloc(sizeof(int) * (size_t)world);
+        if (!cnt || !dsp) die("malloc métricas");
+    }
+
+    int mybytes = nm * (int)sizeof(MetRec);
+    MPI_Gather(&mybytes, 1, MPI_INT, cnt, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    int tot = 0;
+    if (rank == 0) {
+        for (int r = 0; r < world; ++r) { dsp[r] = tot; tot += cnt[r]; }
+        if (!(*recs = (MetRec*)malloc((size_t)tot))) die("malloc métricas");
+        *nrec = tot / (int)sizeof(MetRec);
+    }
+    MPI_Gatherv(mine, mybytes, MPI_BYTE, rank == 0 ? *recs : NULL, cnt, dsp, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (trace) {
+        Event* buf = (Event*)malloc(sizeof(Event) * (size_t)(myev ? myev : 1));
+        if (!buf) die("malloc eventos");
+        size_t o = 0;
+        for (int i = 0; i < nm; ++i) {
+            if (ms[i]->rec.nev) memcpy(buf + o, ms[i]->ev, ms[i]->rec.nev * sizeof(Event));
+            o += ms[i]->rec.nev;
+        }
+        if ((uint64_t)myev * sizeof(Event) > INT32_MAX) die("demasiados eventos para --trace");
+        mybytes = myev * (int)sizeof(Event);
+        MPI_Gather(&mybytes, 1, MPI_INT, cnt, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            uint64_t t64 = 0;
+            for (int r = 0; r < world; ++r) { dsp[r] = (int)t64; t64 += (uint64_t)cnt[r]; }
+            if (t64 > INT32_MAX) die("demasiados eventos para --trace");
+            if (!(*evs = (Event*)malloc(t64 ? (size_t)t64 : 1))) die("malloc eventos");
+            *nev = t64 / sizeof(Event);
+        }
+        MPI_Gatherv(buf, mybytes, MPI_BYTE, rank == 0 ? *evs : NULL, cnt, dsp, MPI_BYTE, 0, MPI_COMM_WORLD);
+        free(buf);
+    }
+    free(cnt); free(dsp);
+}
+
+static void met_write_json(const char* path, const MetRec* recs, int nrec, int world, double wall) {
+    FILE* f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "No se pudo escribir %s\n", path); return; }
+
+    double tot[M_COUNT] = { 0 }, cmax = 0, csum = 0;
+    int nworkers = 0;
+    for (int i = 0; i < nrec; ++i) {
+        for (int j = 0; j < M_COUNT; ++j) tot[j] += recs[i].v[j];
+        if (recs[i].role == ROLE_WORKER) {
+            ++nworkers;
+            csum += recs[i].v[M_compute_s];
+            if (recs[i].v[M_compute_s] > cmax) cmax = recs[i].v[M_compute_s];
+        }
+    }
+    tot[M_dispatch_max_s] = 0;
+    for (int i = 0; i < nrec; ++i)
+        if (recs[i].v[M_dispatch_max_s] > tot[M_dispatch_max_s]) tot[M_dispatch_max_s] = recs[i].v[M_dispatch_max_s];
+
+    fprintf(f, "{\n  \"world\": %d,\n  \"wall_s\": %.6f,\n", world, wall);
+    fprintf(f, "  \"hostnames_per_s\": %.6g,\n", wall > 0 ? tot[M_candidates] / wall : 0.0);
+    fprintf(f, "  \"hostnames_per_s_per_core\": %.6g,\n", tot[M_compute_s] > 0 ? tot[M_candidates] / tot[M_compute_s] : 0.0);
+    // desbalance: el trabajador que más computó contra el promedio (1 = parejo)
+    fprintf(f, "  \"imbalance\": %.4f,\n", csum > 0 ? cmax / (csum / nworkers) : 0.0);
+    fprintf(f, "  \"total\": {");
+    for (int j = 0; j < M_COUNT; ++j) fprintf(f, "%s\"%s\": %.9g", j ? ", " : "", METRIC_NAME[j], tot[j]);
+    fprintf(f, "},\n  \"ranks\": [\n");
+    for (int i = 0; i < nrec; ++i) {
+        fprintf(f, "    {\"rank\": %d, \"thread\": %d, \"role\": \"%s\"", recs[i].rank, recs[i].tid, ROLE_NAME[recs[i].role]);
+        for (int j = 0; j < M_COUNT; ++j) fprintf(f, ", \"%s\": %.9g", METRIC_NAME[j], recs[i].v[j]);
+        fprintf(f, ", \"events_dropped\": %" PRIu64 "}%s\n", recs[i].dropped, i + 1 < nrec ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+// Formato "Trace Event" (chrome://tracing, ui.perfetto.dev): pid = rank, tid = hilo
+static void met_write_trace(const char* path, const MetRec* recs, int nrec, const Event* ev, uint64_t nev) {
+    FILE* f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "No se pudo escribir %s\n", path); return; }
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (int i = 0; i < nrec; ++i) {
+        fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"rank %d\"}},\n",
+                recs[i].rank, recs[i].rank);
+        fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}%s\n",
+                recs[i].rank, recs[i].tid, ROLE_NAME[recs[i].role], i + 1 < nrec || nev ? "," : "");
+    }
+    for (uint64_t i = 0; i < nev; ++i) {
+        const Event* e = &ev[i];
+        const char* an = EV_ARG[e->kind][0], *bn = EV_ARG[e->kind][1];
+        if (e->dur >= 0)
+            fprintf(f, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    EV_NAME[e->kind], e->pid, e->tid, e->ts * 1e6, e->dur * 1e6);
+        else
+            fprintf(f, "{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f",
+                    EV_NAME[e->kind], e->pid, e->tid, e->ts * 1e6);
+        fprintf(f, ", \"args\": {\"%s\": %" PRIu64 ", \"%s\": %" PRIu64 "}}%s\n", an, e->a, bn, e->b, i + 1 < nev ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    fclose(f);
+}
+
+// ---------------- Resultados ----------------
+// Los hallazgos llegan a la raíz de a lotes y salen por un Sink: un buffer propio
+// que se escribe con un solo fwrite cuando se llena (o cada SINK_FLUSH_S segundos,
+// para que por stdout se vean), con los repetidos descartados (una tarea
+// re-emitida puede reportar dos veces el mismo objetivo). Formatos: líneas FOUND
+// por stdout (sin --out), CSV "hostname,idx,rank" o binario (uint64 por hallazgo,
+// en el orden de bytes de la máquina).
+#define HIT_BATCH 256           // hallazgos por mensaje (un lote de candidatos entra entero)
+#define SINK_BUF (1u << 20)
+#define SINK_FLUSH_S 0.5
+
+// Conjunto de índices (hash abierto, crece al 50%)
+typedef struct {
+    uint64_t* a;            // índice + 1 (0 = vacío)
+    uint64_t mask, n;
+} U64Set;
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+// Devuelve 1 si x no estaba
+static int u64set_add(U64Set* s, uint64_t x) {
+    if (!s->a || 2 * (s->n + 1) > s->mask + 1) {
+        const uint64_t cap = s->a ? 2 * (s->mask + 1) : 64;
+        uint64_t* a = (uint64_t*)calloc((size_t)cap, sizeof(uint64_t));
+        if (!a) die("malloc hallazgos");
+        for (uint64_t j = 0; s->a && j <= s->mask; ++j) {
+            if (!s->a[j]) continue;
+            uint64_t k = mix64(s->a[j]) & (cap - 1);
+            while (a[k]) k = (k + 1) & (cap - 1);
+            a[k] = s->a[j];
+        }
+        free(s->a);
+        s->a = a; s->mask = cap - 1;
+    }
+    const uint64_t key = x + 1;
+    uint64_t j = mix64(key) & s->mask;
+    for (; s->a[j]; j = (j + 1) & s->mask)
+        if (s->a[j] == key) return 0;
+    s->a[j] = key; s->n++;
+    return 1;
+}
+
+typedef struct {
+    const Config* cfg;
+    FILE* f;
+    int text;               // 1: líneas FOUND por stdout
+    char* buf;
+    size_t len, cap;
+    double t_flush;
+    U64Set seen;
+    uint64_t n, dup;        // hallazgos escritos y repetidos descartados
+} Sink;
+
+static void sink_open(Sink* s, const Config* cfg) {
+    memset(s, 0, sizeof(*s));
+    s->cfg = cfg;
+    s->text = cfg->out == NULL;
+    s->f = s->text ? stdout : fopen(cfg->out, cfg->out_format == OUT_BIN ? "wb" : "w");
+    if (!s->f) die("no se pudo abrir --out");
+    s->cap = SINK_BUF + strlen(cfg->prefix) + 64;   // siempre entra un registro más
+    if (!(s->buf = (char*)malloc(s->cap))) die("malloc sink");
+    if (!s->text && cfg->out_format == OUT_CSV) s->len = (size_t)sprintf(s->buf, "hostname,idx,rank\n");
+    s->t_flush = MPI_Wtime();
+}
+
+static void sink_flush(Sink* s) {
+    if (s->len && fwrite(s->buf, 1, s->len, s->f) != s->len) die("escritura de --out");
+    s->len = 0;
+    fflush(s->f);
+    s->t_flush = MPI_Wtime();
+}
+
+static void sink_add(Sink* s, int rank, uint64_t idx) {
+    if (!u64set_add(&s->seen, idx)) { s->dup++; return; }
+    s->n++;
+    const Config* cfg = s->cfg;
+    char* o = s->buf + s->len;
+    if (!s->text && cfg->out_format == OUT_BIN) {
+        memcpy(o, &idx, sizeof(idx));
+        s->len += sizeof(idx);
+    } else {
+        char suf[MAX_LEN + 1];
+        index_to_base36(idx, cfg->len, suf);
+        s->len += (size_t)(s->text ? sprintf(o, "[rank %d] FOUND: %s%s (idx=%" PRIu64 ")\n", rank, cfg->prefix, suf, idx)
+                                   : sprintf(o, "%s%s,%" PRIu64 ",%d\n", cfg->prefix, suf, idx, rank));
+    }
+    if (s->len >= SINK_BUF) sink_flush(s);
+}
+
+// Llamado en cada vuelta del maestro
+static void sink_tick(Sink* s) {
+    if (s->len && MPI_Wtime() - s->t_flush >= SINK_FLUSH_S) sink_flush(s);
+}
+
+static void sink_close(Sink* s) {
+    sink_flush(s);
+    if (!s->text) fclose(s->f);
+    free(s->buf); free(s->seen.a);
 }
 
 // ---------------- Protocolo MPI ----------------
-enum { TAG_REQ = 1, TAG_ASSIGN = 2, TAG_FOUND = 3, TAG_STOP = 4 };
+// Cada trabajador tiene siempre a lo sumo un TAG_REQ pendiente y sale recién
+// cuando recibe una asignación inválida: así el maestro sabe cuántos quedan.
+// TAG_CTRL (STOP, STEAL o CANCEL) solo se manda a los trabajadores que todavía no
+// salieron; el trabajador lo tiene siempre pre-posteado y contesta cada STEAL con un
+// TAG_STOLEN. Cada asignación válida es una tarea con id ('lease') y el trabajador la
+// cierra siempre con un TAG_DONE que dice hasta dónde la recorrió (aunque sea nada).
+// Los hallazgos viajan de a lotes: { n, idx[n] } al final del TAG_DONE de la tarea
+// y, si en una tarea hay más de HIT_BATCH, los que no entran en un TAG_FOUND aparte.
+// Un sub-maestro los reenvía a la raíz como { n, rank, idx[n] } en TAG_FOUND, con el
+// rank (de MPI_COMM_WORLD) del trabajador que los encontró.
+enum { TAG_REQ = 1, TAG_ASSIGN = 2, TAG_FOUND = 3, TAG_CTRL = 4, TAG_STOLEN = 5, TAG_DONE = 6 };
+enum { CTRL_STOP = 1, CTRL_STEAL = 2, CTRL_CANCEL = 3 };   // mensaje: { código, lease }
+#define FOUND_END UINT64_MAX   // último TAG_FOUND de cada trabajador (en lugar de n)
+#define STEAL_MIN 4096         // no se parte un rango con menos de 2*STEAL_MIN candidatos sin tocar
 
+// Las tareas son rangos [first, first+count) de la secuencia de candidatos en el
+// orden de la estrategia: la posición g es el candidato r = g % 36^(len-depth) del
+// subprefijo (de 'depth' caracteres) en la posición g / 36^(len-depth) del orden.
+// Con SHUFFLE_ALL la posición g es directamente el candidato perm(g).
+// El maestro reparte subprefijos enteros; un robo puede partir uno por la mitad.
 typedef struct {
-    uint64_t subprefix_id;
+    uint64_t first;     // posición en la secuencia (no el índice del candidato)
+    uint64_t count;     // cantidad de candidatos consecutivos en esa secuencia
+    uint64_t lease;     // id de la tarea en la tabla del maestro (se devuelve en TAG_DONE)
     int      valid;
+    int      stopped;   // asignación inválida por STOP: el trabajador tiene un CTRL_STOP para recibir
 } AssignMsg;
 
+// Profundidad automática: bastantes subprefijos para repartir (>= 64 por proceso)
+// y, si se puede, que ninguno pase de 36^4 candidatos. La cola la terminan los robos.
+static int auto_depth(int len, int world) {
+    const int maxd = len < MAX_DEPTH ? len : MAX_DEPTH;
+    int d = 1;
+    while (d < maxd && (powu(RADIX, d) < 64 * (uint64_t)world || len - d > 4)) ++d;
+    return d;
+}
+
+// Tamaño del próximo lote (en subprefijos) para un cliente que representa 'weight'
+// trabajadores: fijo con --batch N (por trabajador), o guiado (lo que queda / 4 por
+// trabajador, achicándose hasta 1 a medida que se vacía la cola)
+static uint64_t batch_size(const Config* cfg, uint64_t remaining, uint64_t workers, uint64_t weight) {
+    uint64_t b = cfg->batch ? cfg->batch : remaining / (4 * workers);
+    if (b < 1) b = 1;
+    b *= weight;
+    return b < remaining ? b : remaining;
+}
+
 // ---------------- Maestro ----------------
-static void run_master(const Config* cfg, int world, uint64_t total, const uint64_t* targets) {
-    (void)total;
-    const uint64_t SUBSPACE = powu(RADIX, 2);
-
-    int workers = world - 1;
-
-    // Estado continuo
-    uint64_t next_task = 0;
-
-    // Estado barajado
-    uint64_t *ids = NULL, pos = 0;
-    if (cfg->strategy == STRAT_SHUFFLE) {
-        ids = (uint64_t*)malloc((size_t)SUBSPACE * sizeof(uint64_t));
-        if (!ids) die("malloc ids barajado");
-        for (uint64_t i = 0; i < SUBSPACE; ++i) ids[i] = i;
-
-        // Barajar (Fisher-Yates)
-        uint64_t s = cfg->seed ? cfg->seed : 1;
-        for (uint64_t i = SUBSPACE - 1; i > 0; --i) {
-            uint64_t j = splitmix64(&s) % (i + 1);
-            uint64_t t = ids[i]; ids[i] = ids[j]; ids[j] = t;
-        }
-        if (cfg->debug) {
-            printf("[master] Estrategia=SHUFFLE (cola barajada), seed=%" PRIu64 "\n", cfg->seed);
-            fflush(stdout);
+// Dirigido por eventos: por cada cliente hay receives persistentes de TAG_REQ,
+// TAG_FOUND, TAG_STOLEN y TAG_DONE, y el maestro se bloquea en MPI_Waitany hasta que
+// llega cualquiera (sin espera activa ni demora extra por request).
+// Cada cliente cierra su canal de hallazgos con FOUND_END (mismo tag, así llega
+// después de todos sus FOUND): el maestro termina cuando todos los canales están
+// cerrados, no queda ninguna tarea abierta y no se pierde ningún hallazgo en vuelo.
+//
+// Robo de trabajo (--steal 1): con la cola vacía, un pedido no se contesta con
+// "no hay más" mientras algún trabajador tenga un rango grande; el maestro le
+// manda CTRL_STEAL al que más tiene (según lo último que se le dio), éste corta la
+// mitad superior que no tocó y la devuelve en TAG_STOLEN, y el maestro se la da al
+// que pidió. Hay a lo sumo un robo en curso.
+//
+// Tabla de tareas: cada asignación a un trabajador es un Lease con su rango, quién
+// la tiene y desde cuándo (empieza a contar cuando el trabajador cierra la anterior,
+// no cuando se le manda en el doble buffer). Con --straggler X, una tarea que lleva
+// más de X veces lo esperado (mediana de segundos por candidato de las terminadas)
+// se re-emite al próximo que pida; con la cola vacía y sin nada para robar, el que
+// se queda sin trabajo recibe una copia de alguna tarea abierta (primero las que
+// todavía esperan en un doble buffer). Gana la copia que termina primero: a la otra
+// se le manda CTRL_CANCEL. Al final cada par cuenta una vez en 'covered' y lo que se
+// recorrió de más en 'wasted'.
+//
+// Con --hier 1 hay dos niveles. La raíz (rank 0) reparte bloques grandes a un
+// sub-maestro por nodo (comunicador 'leaders'); cada sub-maestro pide el bloque
+// siguiente antes de terminar el actual y lo reparte entre los trabajadores de su
+// nodo (comunicador 'local'), reenviando los hallazgos a la raíz. El STOP baja por
+// un MPI_Ibcast (árbol) sobre 'leaders' y dentro del nodo punto a punto. Los robos
+// y las re-emisiones son solo entre trabajadores del mismo nodo.
+enum { RQ_REQ, RQ_FOUND, RQ_STOLEN, RQ_DONE, NRQ };   // requests por cliente
+#define HELD_MAX 4              // tareas abiertas por cliente (2 en régimen; más si se desordenan los tags)
+#define STRAGGLER_SAMPLES 8     // tareas terminadas antes de confiar en la mediana
+
+typedef struct {
+    MPI_Comm comm;
+    int rank;               // rank del cliente en comm
+    int world_rank;
+    int sub;                // es un sub-maestro: el STOP le llega por el Ibcast
+    int done;               // ya recibió su asignación inválida
+    int waiting;            // pidió con la cola vacía: se le responde al llegar un bloque, un robo o un TAG_DONE
+    uint64_t own;           // candidatos que se estima que tiene (último rango recibido)
+    int held[HELD_MAX];     // tareas abiertas, de la más vieja a la más nueva
+    int nheld;
+    int done_posted;        // receive de TAG_DONE activo (solo con tareas abiertas)
+    uint64_t req_buf;       // peso del pedido (trabajadores que representa)
+    uint64_t found_buf[2 + HIT_BATCH];  // { n, idx[n] }, de un sub-maestro { n, rank, idx[n] }, o { FOUND_END }
+    uint64_t stolen_buf[3]; // { lo, hi, lease } devuelto por un CTRL_STEAL (lo == hi si no cedió nada)
+    uint64_t done_buf[3 + HIT_BATCH];   // { lease, hasta qué posición la recorrió, n, idx[n] }
+} Client;
+
+typedef struct {
+    uint64_t first, end;    // posiciones [first, end) (end baja si le roban)
+    uint64_t reached;       // según su TAG_DONE: recorrió [first, reached)
+    double t0;              // cuándo la empezó (0 = en cola detrás de otra del mismo cliente)
+    int holder;             // cliente
+    int twin;               // la otra copia si se re-emitió (-1 = ninguna)
+    int open;               // sin TAG_DONE todavía
+    int cancelled;          // se le mandó CTRL_CANCEL
+} Lease;
+
+typedef struct {
+    const Config* cfg;
+    const char* who;        // "master" o "sub-master N" (debug)
+    Client* cl;
+    int ncl;
+    MPI_Request* rq;        // NRQ por cliente + bloque de arriba + Ibcast del STOP
+    int active;             // canales de clientes abiertos
+    uint64_t workers;       // trabajadores que reparten esta cola (tamaño guiado)
+    uint64_t rem;           // candidatos por subprefijo
+    uint64_t pos, end;      // posiciones disponibles [pos, end)
+    uint64_t chunk;         // sub-maestro: el bloque se parte en partes iguales (la raíz ya lo achica)
+    int victim, thief;      // robo en curso (-1 = ninguno)
+    // tareas de los trabajadores (no de los sub-maestros)
+    Lease* lease;
+    int nlease, cap_lease;
+    int open;               // tareas sin TAG_DONE
+    double* samp;           // segundos por candidato de las tareas terminadas enteras
+    int nsamp, cap_samp, med_n;
+    double med;             // mediana de samp con med_n muestras
+    Sink* sink;             // raíz: salida de hallazgos (NULL en los sub-maestros)
+    // sub-maestro: bloque pedido a la raíz
+    MPI_Comm up;            // 'leaders' (MPI_COMM_NULL en la raíz y sin --hier)
+    AssignMsg up_msg;
+    int up_pending, up_done, have_next;
+    uint64_t next_lo, next_hi;
+    // STOP
+    MPI_Comm bc;            // 'leaders' con --hier
+    int stop_flag, bc_posted;
+    int stopped;            // ya se mandó STOP a los clientes (y no se reparte más)
+    Metrics* met;
+} Master;
+
+static int master_is_root(const Master* M) { return M->up == MPI_COMM_NULL; }
+
+static void master_set_block(Master* M, uint64_t lo, uint64_t hi) {
+    M->pos = lo; M->end = hi;
+    const uint64_t units = (hi - lo + M->rem - 1) / M->rem;
+    M->chunk = (units + M->workers - 1) / M->workers * M->rem;
+}
+
+static void master_add_clients(Master* M, MPI_Comm comm, int from, int sub) {
+    int n; MPI_Comm_size(comm, &n);
+    MPI_Group g, wg;
+    MPI_Comm_group(comm, &g);
+    MPI_Comm_group(MPI_COMM_WORLD, &wg);
+    for (int r = from; r < n; ++r) {
+        Client* c = &M->cl[M->ncl++];
+        memset(c, 0, sizeof(*c));
+        c->comm = comm; c->rank = r; c->sub = sub;
+        MPI_Group_translate_ranks(g, 1, &r, wg, &c->world_rank);
+    }
+    MPI_Group_free(&g);
+    MPI_Group_free(&wg);
+}
+
+static void master_ctrl(Master* M, int j, uint64_t code, uint64_t lease) {
+    const uint64_t m[2] = { code, lease };
+    MPI_Send(m, 2, MPI_UINT64_T, M->cl[j].rank, TAG_CTRL, M->cl[j].comm);
+}
+
+// Pide el próximo bloque a la raíz si hace falta (sub-maestro). Después de un STOP
+// se sigue pidiendo (y descartando) hasta la respuesta inválida que cierra el canal.
+static void master_fetch(Master* M) {
+    if (master_is_root(M) || M->up_pending || M->up_done) return;
+    if (!M->stopped && M->have_next) return;
+    MPI_Send(&M->workers, 1, MPI_UINT64_T, 0, TAG_REQ, M->up);
+    MPI_Irecv(&M->up_msg, sizeof(M->up_msg), MPI_BYTE, 0, TAG_ASSIGN, M->up, &M->rq[NRQ * M->ncl]);
+    M->up_pending = 1;
+}
+
+// Abre una tarea [first, first+count) para el cliente i (twin: la tarea que copia)
+static int master_lease(Master* M, int i, uint64_t first, uint64_t count, int twin) {
+    Client* c = &M->cl[i];
+    if (c->nheld == HELD_MAX) die("demasiadas tareas abiertas en un trabajador");
+    if (M->nlease == M->cap_lease) {
+        M->cap_lease = M->cap_lease ? 2 * M->cap_lease : 256;
+        if (!(M->lease = (Lease*)realloc(M->lease, sizeof(Lease) * (size_t)M->cap_lease))) die("malloc tareas");
+    }
+    const int id = M->nlease++;
+    Lease* L = &M->lease[id];
+    L->first = first; L->end = first + count; L->reached = first;
+    L->t0 = c->nheld ? 0 : MPI_Wtime();
+    L->holder = i; L->twin = twin;
+    L->open = 1; L->cancelled = 0;
+    if (twin >= 0) M->lease[twin].twin = id;
+    c->held[c->nheld++] = id;
+    if (!c->done_posted) { MPI_Start(&M->rq[NRQ * i + RQ_DONE]); c->done_posted = 1; }
+    ++M->open;
+    return id;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Mediana de segundos por candidato (0 = todavía pocas muestras). Se reordena
+// recién cuando las muestras crecen un 1/8: costo amortizado O(log n) por tarea.
+static double master_median(Master* M) {
+    if (M->nsamp < STRAGGLER_SAMPLES) return 0;
+    if (M->nsamp > M->med_n + M->med_n / 8) {
+        qsort(M->samp, (size_t)M->nsamp, sizeof(double), cmp_double);
+        M->med_n = M->nsamp;
+        M->med = M->samp[M->nsamp / 2];
+    }
+    return M->med;
+}
+
+// Qué tarea abierta re-emitir al cliente i (-1 = ninguna). Con tail (cola vacía):
+// cualquiera sin copia, primero las que esperan en un doble buffer y si no la que
+// empezó antes; si no, solo la más atrasada de las que pasaron --straggler veces lo
+// esperado.
+static int master_straggler(Master* M, int i, int tail) {
+    if (!M->cfg->straggler || M->cl[i].sub || M->stopped) return -1;
+    const double now = MPI_Wtime(), med = tail ? 0 : master_median(M);
+    if (!tail && med <= 0) return -1;
+    int best = -1;
+    double score = 0;
+    for (int j = 0; j < M->ncl; ++j) {
+        const Client* c = &M->cl[j];
+        if (j == i || c->sub || j == M->victim) continue;
+        for (int h = 0; h < c->nheld; ++h) {
+            const Lease* L = &M->lease[c->held[h]];
+            if (L->twin >= 0 || L->cancelled) continue;
+            double sc;
+            if (tail) {
+                sc = L->t0 == 0 ? 1e300 : now - L->t0;
+            } else {
+                if (L->t0 == 0) continue;
+                sc = (now - L->t0) / (med * (double)(L->end - L->first));
+                if (sc < M->cfg->straggler) continue;
+            }
+            if (best < 0 || sc > score) { best = c->held[h]; score = sc; }
         }
-    } else if (cfg->debug) {
-        printf("[master] Estrategia=CONTIG (orden 0..N-1)\n");
+    }
+    return best;
+}
+
+static void master_send(Master* M, int i, const AssignMsg* msg) {
+    Client* c = &M->cl[i];
+    c->waiting = 0;
+    MPI_Send(msg, sizeof(*msg), MPI_BYTE, c->rank, TAG_ASSIGN, c->comm);
+
+    if (M->cfg->debug) {
+        if (msg->valid)
+            printf("[%s] ASSIGN -> rank %d  posiciones [%" PRIu64 ", %" PRIu64 ")  (%" PRIu64 " candidatos)\n",
+                   M->who, c->world_rank, msg->first, msg->first + msg->count, msg->count);
+        else
+            printf("[%s] NO MORE WORK -> rank %d\n", M->who, c->world_rank);
         fflush(stdout);
     }
 
-    int stop_broadcasted = 0;
+    if (msg->valid) { c->own = msg->count; MPI_Start(&M->rq[NRQ * i + RQ_REQ]); }
+    else { c->done = 1; --M->active; }
+}
 
-    if (cfg->print_targets && cfg->n_live > 0) {
-        printf("[master] Objetivos simulados:\n");
-        for (int i = 0; i < cfg->n_live; ++i) {
-            char suf[64];
-            index_to_base36(targets[i], cfg->len, suf);
-            printf("  %s%s\n", cfg->prefix, suf);
-        }
+// Manda al cliente i una copia de la tarea id
+static void master_reissue(Master* M, int i, int id) {
+    const Lease L = M->lease[id];   // copia: master_lease puede mover la tabla
+    AssignMsg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.valid = 1;
+    msg.first = L.first;
+    msg.count = L.end - L.first;
+    msg.lease = (uint64_t)master_lease(M, i, msg.first, msg.count, id);
+    M->met->rec.v[M_reissued]++;
+    met_event(M->met, EV_REISSUE, MPI_Wtime(), -1, (uint64_t)id, (uint64_t)M->cl[i].world_rank);
+    if (M->cfg->debug) {
+        printf("[%s] REISSUE tarea %d (rank %d) -> rank %d  [%" PRIu64 ", %" PRIu64 ")\n",
+               M->who, id, M->cl[L.holder].world_rank, M->cl[i].world_rank, L.first, L.end);
         fflush(stdout);
     }
+    master_send(M, i, &msg);
+}
+
+static int master_twinned(const Master* M, const Client* c) {
+    for (int h = 0; h < c->nheld; ++h)
+        if (M->lease[c->held[h]].twin >= 0) return 1;
+    return 0;
+}
+
+// Con la cola vacía: deja al cliente i esperando un robo. Devuelve 0 si no queda
+// nadie de quien robar (hay que contestarle que no hay más). No se roba a quien
+// tiene una tarea con copia: las dos copias tienen que seguir siendo iguales.
+static int master_steal(Master* M, int i) {
+    if (!M->cfg->steal || M->cl[i].sub) return 0;
+    M->cl[i].waiting = 1;
+    if (M->victim >= 0) return 1;   // se lo atiende cuando vuelva el robo en curso
+
+    int v = -1;
+    for (int j = 0; j < M->ncl; ++j) {
+        const Client* c = &M->cl[j];
+        if (j == i || c->sub || c->done || c->own < 2 * STEAL_MIN || master_twinned(M, c)) continue;
+        if (v < 0 || c->own > M->cl[v].own) v = j;
+    }
+    if (v < 0) { M->cl[i].waiting = 0; return 0; }
 
-    while (workers > 0) {
-        MPI_Status st;
+    MPI_Start(&M->rq[NRQ * v + RQ_STOLEN]);
+    master_ctrl(M, v, CTRL_STEAL, 0);
+    M->victim = v; M->thief = i;
+    return 1;
+}
 
-        // ¿Alguien encontró?
-        int flag_found = 0;
-        MPI_Iprobe(MPI_ANY_SOURCE, TAG_FOUND, MPI_COMM_WORLD, &flag_found, &st);
-        if (flag_found) {
-            uint64_t idx;
-            MPI_Recv(&idx, 1, MPI_UINT64_T, st.MPI_SOURCE, TAG_FOUND, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            print_found(st.MPI_SOURCE, cfg->prefix, cfg->len, idx);
+// Con la cola vacía y nada para robar, con --straggler: el cliente i queda esperando
+// hasta cerrar sus tareas (así nunca sale nadie con una tarea abierta que después
+// haya que cancelar) y entonces recibe una copia de alguna tarea abierta de otro.
+// Devuelve 0 si no hay nada que copiar.
+static int master_speculate(Master* M, int i) {
+    if (!M->cfg->straggler || M->cl[i].sub) return 0;
+    if (M->cl[i].nheld > 0) { M->cl[i].waiting = 1; return 1; }
+    const int id = master_straggler(M, i, 1);
+    if (id < 0) return 0;
+    master_reissue(M, i, id);
+    return 1;
+}
 
-            if (cfg->stop_on_first && !stop_broadcasted) {
-                if (cfg->debug) printf("[master] STOP broadcast (primer hallazgo)\n"), fflush(stdout);
-                int one = 1;
-                for (int p = 1; p < world; ++p)
-                    MPI_Send(&one, 1, MPI_INT, p, TAG_STOP, MPI_COMM_WORLD);
-                stop_broadcasted = 1;
-            }
+// Responde el pedido del cliente i. Con la cola vacía y un bloque, un robo o una
+// copia en camino, lo deja esperando (se vuelve a llamar cuando llega).
+static void master_reply(Master* M, int i) {
+    Client* c = &M->cl[i];
+    AssignMsg msg;
+    memset(&msg, 0, sizeof(msg));
+    if (!M->stopped) {
+        if (M->pos == M->end && M->have_next) {
+            master_set_block(M, M->next_lo, M->next_hi); M->have_next = 0;
+            master_fetch(M);
         }
-
-        // ¿Hay request de trabajo?
-        int flag_req = 0;
-        MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQ, MPI_COMM_WORLD, &flag_req, &st);
-        if (flag_req) {
-            uint64_t dummy;
-            MPI_Recv(&dummy, 1, MPI_UINT64_T, st.MPI_SOURCE, TAG_REQ, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-            AssignMsg msg;
-            uint64_t remaining =
-                (cfg->strategy == STRAT_SHUFFLE) ? (SUBSPACE - pos) : (SUBSPACE - next_task);
-            
-            if (stop_broadcasted || remaining == 0) {
-                msg.valid = 0;
-                msg.subprefix_id = 0;
+        const int late = c->req_buf > 0 ? master_straggler(M, i, 0) : -1;
+        if (late >= 0) {
+            master_reissue(M, i, late);
+            return;
+        }
+        if (M->pos < M->end && c->req_buf > 0) {
+            msg.valid = 1;
+            msg.first = M->pos;
+            if (master_is_root(M) || M->cfg->batch) {
+                uint64_t units = batch_size(M->cfg, (M->end - M->pos + M->rem - 1) / M->rem, M->workers, c->req_buf);
+                msg.count = units * M->rem;
             } else {
-                msg.valid = 1;
-                msg.subprefix_id = (cfg->strategy == STRAT_SHUFFLE)
-                                     ? ids[pos++]
-                                     : next_task++;
+                msg.count = M->chunk;
             }
+            if (msg.count > M->end - M->pos) msg.count = M->end - M->pos;
+            M->pos += msg.count;
+            if (!c->sub) msg.lease = (uint64_t)master_lease(M, i, msg.first, msg.count, -1);
+        } else if (!master_is_root(M) && !M->up_done) {
+            c->waiting = 1;
+            master_fetch(M);
+            return;
+        } else if (master_steal(M, i) || master_speculate(M, i)) {
+            return;
+        }
+    }
+    msg.stopped = M->stopped && !c->sub;
+    master_send(M, i, &msg);
+}
 
-            MPI_Send(&msg, sizeof(msg), MPI_BYTE, st.MPI_SOURCE, TAG_ASSIGN, MPI_COMM_WORLD);
+static void master_reply_waiting(Master* M) {
+    for (int j = 0; j < M->ncl; ++j)
+        if (M->cl[j].waiting) master_reply(M, j);
+}
 
-            if (cfg->debug) {
-                if (msg.valid) {
-                    char c0, c1; subprefix_id_to_chars(msg.subprefix_id, &c0, &c1);
-                    printf("[master] ASSIGN -> rank %d  subprefijo=%c%c (id=%" PRIu64 ")\n",
-                           st.MPI_SOURCE, c0, c1, msg.subprefix_id);
-                } else {
-                    printf("[master] NO MORE WORK -> rank %d\n", st.MPI_SOURCE);
-                }
+// Volvió el robo en curso: la tarea de la víctima se achica, el rango va al que
+// esperaba y se reintenta con el resto
+static void master_stolen(Master* M, int v) {
+    Client* c = &M->cl[v];
+    const int t = M->thief;
+    M->victim = M->thief = -1;
+    const uint64_t lo = c->stolen_buf[0], hi = c->stolen_buf[1];
+    if (M->cfg->debug) {
+        printf("[%s] STEAL rank %d -> rank %d  [%" PRIu64 ", %" PRIu64 ")\n",
+               M->who, c->world_rank, M->cl[t].world_rank, lo, hi);
+        fflush(stdout);
+    }
+    met_event(M->met, EV_STEAL, MPI_Wtime(), -1, (uint64_t)c->world_rank, (uint64_t)M->cl[t].world_rank);
+    if (hi > lo) {
+        if (c->stolen_buf[2] >= (uint64_t)M->nlease) die("TAG_STOLEN con una tarea desconocida");
+        M->lease[c->stolen_buf[2]].end = lo;
+    }
+    if (hi > lo && !M->stopped && M->cl[t].waiting) {
+        M->met->rec.v[M_steals]++;
+        c->own = hi - lo;
+        AssignMsg msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.first = lo; msg.count = hi - lo; msg.valid = 1;
+        msg.lease = (uint64_t)master_lease(M, t, lo, hi - lo, -1);
+        master_send(M, t, &msg);
+    } else {
+        c->own = 0;
+    }
+    master_reply_waiting(M);
+}
+
+static void master_stop(Master* M) {
+    if (M->stopped) return;
+    M->stopped = 1;
+    if (M->sink) sink_flush(M->sink);
+    met_event(M->met, EV_STOP, MPI_Wtime(), -1, 0, 0);
+    if (M->cfg->debug) printf("[%s] STOP broadcast (primer hallazgo)\n", M->who), fflush(stdout);
+    if (M->bc != MPI_COMM_NULL && master_is_root(M) && !M->bc_posted) {
+        M->stop_flag = 1;
+        MPI_Ibcast(&M->stop_flag, 1, MPI_INT, 0, M->bc, &M->rq[NRQ * M->ncl + 1]);
+        M->bc_posted = 1;
+    }
+    for (int j = 0; j < M->ncl; ++j)
+        if (!M->cl[j].done && !M->cl[j].sub) master_ctrl(M, j, CTRL_STOP, 0);
+    master_reply_waiting(M);
+    master_fetch(M);
+}
+
+// Lote de n hallazgos idx[] del trabajador 'rank' (de MPI_COMM_WORLD): el sub-maestro
+// lo reenvía a la raíz como { n, rank, idx[n] } y la raíz lo pasa al Sink
+static void master_hits(Master* M, int rank, uint64_t n, const uint64_t* idx) {
+    if (n == 0) return;
+    if (n > HIT_BATCH) die("lote de hallazgos inválido");
+    if (!master_is_root(M)) {
+        uint64_t fwd[2 + HIT_BATCH];
+        fwd[0] = n;
+        fwd[1] = (uint64_t)rank;
+        memcpy(&fwd[2], idx, n * sizeof *idx);
+        MPI_Send(fwd, (int)(2 + n), MPI_UINT64_T, 0, TAG_FOUND, M->up);
+    } else {
+        for (uint64_t j = 0; j < n; ++j) sink_add(M->sink, rank, idx[j]);
+    }
+    if (M->cfg->stop_on_first) master_stop(M);
+}
+
+// Cerró una tarea (con los hallazgos que quedaban). Si la recorrió entera es una muestra para la mediana y, si tenía
+// una copia abierta, se cancela la copia. La siguiente tarea del cliente empieza ahora.
+static void master_done(Master* M, int i) {
+    Client* c = &M->cl[i];
+    const uint64_t id = c->done_buf[0];
+    if (id >= (uint64_t)M->nlease || !M->lease[id].open) die("TAG_DONE con una tarea desconocida");
+    master_hits(M, c->world_rank, c->done_buf[2], &c->done_buf[3]);
+    Lease* L = &M->lease[id];
+    const double now = MPI_Wtime();
+    L->reached = c->done_buf[1];
+    L->open = 0;
+    --M->open;
+    int h = 0;
+    while (c->held[h] != (int)id) ++h;
+    for (--c->nheld; h < c->nheld; ++h) c->held[h] = c->held[h + 1];
+
+    if (L->reached == L->end && !L->cancelled) {
+        if (L->t0 > 0) {
+            if (M->nsamp == M->cap_samp) {
+                M->cap_samp = M->cap_samp ? 2 * M->cap_samp : 256;
+                if (!(M->samp = (double*)realloc(M->samp, sizeof(double) * (size_t)M->cap_samp))) die("malloc muestras");
+            }
+            M->samp[M->nsamp++] = (now - L->t0) / (double)(L->end - L->first);
+        }
+        Lease* T = L->twin >= 0 ? &M->lease[L->twin] : NULL;
+        if (T && T->open && !T->cancelled && !M->stopped && !M->cl[T->holder].done) {
+            T->cancelled = 1;
+            M->met->rec.v[M_cancelled]++;
+            master_ctrl(M, T->holder, CTRL_CANCEL, (uint64_t)L->twin);
+            met_event(M->met, EV_CANCEL, now, -1, (uint64_t)L->twin, (uint64_t)M->cl[T->holder].world_rank);
+            if (M->cfg->debug) {
+                printf("[%s] CANCEL tarea %d en rank %d (la terminó rank %d)\n",
+                       M->who, L->twin, M->cl[T->holder].world_rank, c->world_rank);
                 fflush(stdout);
             }
+        }
+    }
 
-            if (!msg.valid) --workers;
+    if (c->nheld > 0) {
+        Lease* N = &M->lease[c->held[0]];
+        if (N->t0 == 0) N->t0 = now;
+        MPI_Start(&M->rq[NRQ * i + RQ_DONE]);
+    } else {
+        c->done_posted = 0;
+    }
+    master_reply_waiting(M);
+}
+
+// Cobertura exacta: de cada tarea (o par de copias, que tienen el mismo rango) cuenta
+// la unión de lo recorrido; lo que recorrió de más la copia perdedora va a 'wasted'.
+static void master_account(Master* M) {
+    uint64_t covered = 0, wasted = 0;
+    for (int id = 0; id < M->nlease; ++id) {
+        const Lease* L = &M->lease[id];
+        if (L->twin >= 0 && L->twin < id) continue;
+        uint64_t u = L->reached - L->first, sum = u;
+        if (L->twin >= 0) {
+            const uint64_t b = M->lease[L->twin].reached - M->lease[L->twin].first;
+            if (b > u) u = b;
+            sum += b;
         }
+        covered += u;
+        wasted += sum - u;
+    }
+    M->met->rec.v[M_covered] += (double)covered;
+    M->met->rec.v[M_wasted] += (double)wasted;
+}
 
-        if (!flag_found && !flag_req) {
-            double t0 = MPI_Wtime();
-            while (MPI_Wtime() - t0 < 0.001) { /* yield ~1 ms */ }
+// Atiende la request k que completó MPI_Waitany
+static void master_dispatch(Master* M, int k) {
+    if (k == NRQ * M->ncl) {
+        // bloque de la raíz (sub-maestro)
+        M->up_pending = 0;
+        if (!M->up_msg.valid) M->up_done = 1;
+        else if (!M->stopped) {
+            if (M->pos == M->end) master_set_block(M, M->up_msg.first, M->up_msg.first + M->up_msg.count);
+            else { M->next_lo = M->up_msg.first; M->next_hi = M->up_msg.first + M->up_msg.count; M->have_next = 1; }
         }
+        master_reply_waiting(M);
+        master_fetch(M);
+        return;
+    }
+    if (k == NRQ * M->ncl + 1) {
+        // STOP de la raíz (sub-maestro); en la raíz es su propio Ibcast
+        if (M->stop_flag) master_stop(M);
+        return;
+    }
 
+    const int i = k / NRQ;
+    Client* c = &M->cl[i];
+    switch (k % NRQ) {
+    case RQ_STOLEN:
+        master_stolen(M, i);
+        break;
+    case RQ_DONE:
+        master_done(M, i);
+        break;
+    case RQ_FOUND:
+        // lote de hallazgos (o fin de hallazgos de ese cliente)
+        if (c->found_buf[0] == FOUND_END) { --M->active; break; }
+        if (c->sub) master_hits(M, (int)c->found_buf[1], c->found_buf[0], &c->found_buf[2]);
+        else master_hits(M, c->world_rank, c->found_buf[0], &c->found_buf[1]);
+        MPI_Start(&M->rq[k]);
+        break;
+    default:
+        // request de trabajo. Un TAG_DONE de este cliente que ya llegó va primero:
+        // Waitany prefiere el índice más bajo y si no la tabla crecería sin cerrar tareas.
+        if (c->done_posted) {
+            int flag = 0;
+            MPI_Test(&M->rq[NRQ * i + RQ_DONE], &flag, MPI_STATUS_IGNORE);
+            if (flag) master_done(M, i);
+        }
+        master_reply(M, i);
     }
+}
+
+static void run_master(const Config* cfg, MPI_Comm local, MPI_Comm leaders, int world,
+                       const TargetSet* ts, int self_worker, Metrics* met, Sink* sink) {
+    int wrank; MPI_Comm_rank(MPI_COMM_WORLD, &wrank);
+    int nlocal; MPI_Comm_size(local, &nlocal);
+    int nlead = 1;
+    if (leaders != MPI_COMM_NULL) MPI_Comm_size(leaders, &nlead);
+
+    Master M;
+    memset(&M, 0, sizeof(M));
+    char who[32];
+    snprintf(who, sizeof(who), wrank == 0 ? "master" : "sub-master %d", wrank);
+    M.cfg = cfg; M.who = who; M.met = met; M.sink = sink;
+    M.rem = powu(RADIX, cfg->len - cfg->depth);
+    M.victim = M.thief = -1;
+    M.up = (wrank == 0) ? MPI_COMM_NULL : leaders;
+    M.bc = leaders;
+    M.cl = (Client*)malloc(sizeof(Client) * (size_t)(nlocal + nlead));
+    M.rq = (MPI_Request*)malloc(sizeof(MPI_Request) * (NRQ * (size_t)(nlocal + nlead) + 2));
+    if (!M.cl || !M.rq) die("malloc maestro");
+
+    // clientes: trabajadores del nodo (y el hilo ayudante propio); en la raíz además
+    // los otros sub-maestros
+    master_add_clients(&M, local, self_worker ? 0 : 1, 0);
+    M.workers = (uint64_t)M.ncl;
+    if (master_is_root(&M)) {
+        if (leaders != MPI_COMM_NULL) master_add_clients(&M, leaders, 1, 1);
+        M.workers = (uint64_t)(world - nlead + (self_worker ? nlead : 0));
+        M.end = powu(RADIX, cfg->len);
+    }
+    for (int i = 0; i < NRQ * M.ncl + 2; ++i) M.rq[i] = MPI_REQUEST_NULL;
+    for (int i = 0; i < M.ncl; ++i) {
+        Client* c = &M.cl[i];
+        MPI_Request* r = &M.rq[NRQ * i];
+        MPI_Recv_init(&c->req_buf, 1, MPI_UINT64_T, c->rank, TAG_REQ, c->comm, &r[RQ_REQ]);
+        MPI_Recv_init(c->found_buf, 2 + HIT_BATCH, MPI_UINT64_T, c->rank, TAG_FOUND, c->comm, &r[RQ_FOUND]);
+        MPI_Recv_init(c->stolen_buf, 3, MPI_UINT64_T, c->rank, TAG_STOLEN, c->comm, &r[RQ_STOLEN]);
+        MPI_Recv_init(c->done_buf, 3 + HIT_BATCH, MPI_UINT64_T, c->rank, TAG_DONE, c->comm, &r[RQ_DONE]);
+        MPI_Start(&r[RQ_REQ]);
+        MPI_Start(&r[RQ_FOUND]);
+    }
+    M.active = 2 * M.ncl;
+    if (!master_is_root(&M)) {
+        MPI_Ibcast(&M.stop_flag, 1, MPI_INT, 0, M.bc, &M.rq[NRQ * M.ncl + 1]);
+        M.bc_posted = 1;
+        master_fetch(&M);
+    }
+
+    if (cfg->debug && master_is_root(&M)) {
+        if (cfg->strategy == STRAT_SHUFFLE)
+            printf("[master] Estrategia=SHUFFLE (subprefijos permutados), seed=%" PRIu64 "\n", cfg->seed);
+        else if (cfg->strategy == STRAT_SHUFFLE_ALL)
+            printf("[master] Estrategia=SHUFFLE_ALL (candidatos permutados), seed=%" PRIu64 "\n", cfg->seed);
+        else
+            printf("[master] Estrategia=CONTIG (orden 0..N-1)\n");
+        printf("[master] Subprefijos de %d caracteres (%" PRIu64 " candidatos cada uno)\n", cfg->depth, M.rem);
+        printf("[master] Lotes: %s%s%s%s%s\n", cfg->batch ? "fijos (--batch)" : "guiados",
+               cfg->steal ? ", con robo de trabajo" : "",
+               cfg->straggler > 0 ? ", con re-emisión de tareas atrasadas" : "",
+               self_worker ? ", los maestros también trabajan (hilo ayudante)" : "",
+               leaders != MPI_COMM_NULL ? ", jerárquico" : "");
+        if (leaders != MPI_COMM_NULL) printf("[master] %d sub-maestros (incluida la raíz)\n", nlead);
+        fflush(stdout);
+    }
+
+    if (cfg->print_targets && ts->n > 0 && master_is_root(&M)) {
+        printf("[master] Objetivos simulados:\n");
+        for (int i = 0; i < ts->n; ++i) {
+            char suf[64];
+            index_to_base36(ts->idx[i], cfg->len, suf);
+            printf("  %s%s\n", cfg->prefix, suf);
+        }
+        fflush(stdout);
+    }
+
+    // el sub-maestro sigue hasta que la raíz le cierra el canal de bloques; nadie
+    // sale con un robo en curso (su TAG_STOLEN tiene que llegar) ni con tareas sin
+    // su TAG_DONE
+    while (M.active > 0 || M.victim >= 0 || M.open > 0 || (!master_is_root(&M) && !M.up_done)) {
+        int k;
+        const double tw = MPI_Wtime();
+        MPI_Waitany(NRQ * M.ncl + 2, M.rq, &k, MPI_STATUS_IGNORE);
+        if (k == MPI_UNDEFINED) die("maestro sin requests activos");
+        const double td = MPI_Wtime();
+        met->rec.v[M_idle_s] += td - tw;
+        master_dispatch(&M, k);
+        if (M.sink) sink_tick(M.sink);
+        const double dt = MPI_Wtime() - td;
+        met->rec.v[M_msgs]++;
+        met->rec.v[M_dispatch_s] += dt;
+        if (dt > met->rec.v[M_dispatch_max_s]) met->rec.v[M_dispatch_max_s] = dt;
+        if (met->trace) {
+            static const int TAGS[NRQ] = { TAG_REQ, TAG_FOUND, TAG_STOLEN, TAG_DONE };
+            const int cli = k < NRQ * M.ncl;
+            met_event(met, EV_DISPATCH, td, dt, (uint64_t)(cli ? TAGS[k % NRQ] : k == NRQ * M.ncl ? TAG_ASSIGN : 0),
+                      cli ? (uint64_t)M.cl[k / NRQ].world_rank : 0);
+        }
+    }
+    master_account(&M);
 
-    // Liberar recursos en caso de barajado
-    if (ids) free(ids);
+    if (!master_is_root(&M)) {
+        uint64_t end = FOUND_END;
+        MPI_Send(&end, 1, MPI_UINT64_T, 0, TAG_FOUND, M.up);
+    } else if (M.bc != MPI_COMM_NULL && !M.bc_posted) {
+        // nadie pidió STOP: el Ibcast igual se completa para liberar a los sub-maestros
+        M.stop_flag = 0;
+        MPI_Ibcast(&M.stop_flag, 1, MPI_INT, 0, M.bc, &M.rq[NRQ * M.ncl + 1]);
+    }
+    MPI_Wait(&M.rq[NRQ * M.ncl + 1], MPI_STATUS_IGNORE);
+
+    for (int j = 0; j < NRQ * M.ncl; ++j) MPI_Request_free(&M.rq[j]);
+    free(M.cl); free(M.rq);
+    free(M.lease); free(M.samp);
 }
 
 // ---------------- Trabajador ----------------
-static void run_worker(const Config* cfg, int rank, uint64_t total, const uint64_t* targets) {
-    (void)total;
-    const uint64_t REMSPACE = powu(RADIX, cfg->len - 2);
+// El trabajador habla con el rank 0 de 'comm': el maestro (MPI_COMM_WORLD) o, con
+// --hier 1, el sub-maestro de su nodo.
 
-    while (1) {
-        // ¿STOP global?
-        int has_stop = 0; MPI_Status stp;
-        MPI_Iprobe(0, TAG_STOP, MPI_COMM_WORLD, &has_stop, &stp);
-        if (has_stop) { int tmp; MPI_Recv(&tmp, 1, MPI_INT, 0, TAG_STOP, MPI_COMM_WORLD, MPI_STATUS_IGNORE); break; }
+// Pide el próximo lote sin bloquear (la respuesta llega mientras se computa el actual)
+static void post_request(MPI_Comm comm, AssignMsg* next, MPI_Request rq[2]) {
+    static uint64_t req = 1;
+    MPI_Isend(&req, 1, MPI_UINT64_T, 0, TAG_REQ, comm, &rq[0]);
+    MPI_Irecv(next, sizeof(*next), MPI_BYTE, 0, TAG_ASSIGN, comm, &rq[1]);
+}
+
+// Canal de control: un Irecv de TAG_CTRL siempre posteado hasta que llega el STOP
+#define SKIP_MAX 4   // CTRL_CANCEL de tareas que todavía no empezaron (o ya cerraron)
+typedef struct {
+    MPI_Comm comm;
+    MPI_Request rq;
+    uint64_t msg[2];    // { código, lease }
+    int got_stop;
+    uint64_t lease;     // tarea que se está recorriendo (NO_LEASE = ninguna)
+    uint64_t skip[SKIP_MAX];
+    int nskip;
+    Metrics* met;
+} Ctrl;
+
+#define NO_LEASE UINT64_MAX
 
-        // pedir tarea
-        uint64_t req = 1;
-        MPI_Send(&req, 1, MPI_UINT64_T, 0, TAG_REQ, MPI_COMM_WORLD);
+static void ctrl_post(Ctrl* c) {
+    MPI_Irecv(c->msg, 2, MPI_UINT64_T, 0, TAG_CTRL, c->comm, &c->rq);
+}
 
-        // recibir asignación
-        MPI_Status st; AssignMsg msg;
-        MPI_Recv(&msg, sizeof(msg), MPI_BYTE, 0, TAG_ASSIGN, MPI_COMM_WORLD, &st);
-        if (!msg.valid) break;
+static int ctrl_skipped(const Ctrl* c, uint64_t lease) {
+    for (int i = 0; i < SKIP_MAX && i < c->nskip; ++i)
+        if (c->skip[i] == lease) return 1;
+    return 0;
+}
+
+// Atiende el mensaje de control recibido. [g, *hi) es lo que queda sin tocar del
+// rango actual (hi = NULL si no hay): un STEAL se lleva su mitad superior y un
+// CANCEL de esta tarea lo corta entero; el CANCEL de otra se anota para saltearla.
+static void ctrl_handle(Ctrl* c, uint64_t g, uint64_t* hi) {
+    if (c->msg[0] == CTRL_STOP) { c->got_stop = 1; return; }
+    if (c->msg[0] == CTRL_CANCEL) {
+        if (hi && c->msg[1] == c->lease) *hi = g;
+        else c->skip[c->nskip++ % SKIP_MAX] = c->msg[1];
+        ctrl_post(c);
+        return;
+    }
+    uint64_t out[3] = { 0, 0, c->lease };
+    if (hi && *hi > g && *hi - g >= 2 * STEAL_MIN) {
+        out[0] = g + (*hi - g) / 2; out[1] = *hi;
+        *hi = out[0];
+        c->met->rec.v[M_steals]++;
+    }
+    MPI_Send(out, 3, MPI_UINT64_T, 0, TAG_STOLEN, c->comm);
+    ctrl_post(c);
+}
+
+// Espera la asignación pedida atendiendo STEAL/STOP mientras tanto
+static void wait_assign(Ctrl* ctl, MPI_Request rq[2]) {
+    const double t = MPI_Wtime();
+    while (rq[0] != MPI_REQUEST_NULL || rq[1] != MPI_REQUEST_NULL) {
+        MPI_Request w[3] = { rq[0], rq[1], ctl->rq };
+        int k;
+        MPI_Waitany(3, w, &k, MPI_STATUS_IGNORE);
+        rq[0] = w[0]; rq[1] = w[1]; ctl->rq = w[2];
+        if (k == 2) ctrl_handle(ctl, 0, NULL);
+    }
+    const double dt = MPI_Wtime() - t;
+    ctl->met->rec.v[M_wait_assign_s] += dt;
+    met_event(ctl->met, EV_WAIT, t, dt, 0, 0);
+}
+
+// Estado del barrido de un trabajador
+typedef struct {
+    const Config* cfg;
+    const Predicate* pred;
+    Order order;
+    uint64_t REMSPACE;
+    Ctrl* ctl;
+    int rank;
+    CandBatch cb;
+    int hit[CAND_BATCH];
+    uint64_t cand[CAND_BATCH];  // índices del lote con SHUFFLE_ALL
+    uint64_t report[3 + HIT_BATCH]; // TAG_DONE de la tarea: { lease, hasta dónde, n, idx[n] }
+    Metrics* met;
+    // el canal de control se consulta cada poll_blocks lotes, ajustado para que
+    // entre consultas pasen ~--cancel_ms (latencia acotada de STOP/STEAL)
+    uint32_t poll_blocks, blocks_left;
+    double t_poll;
+    uint64_t next_progress;
+} Scan;
 
-        char c0, c1; subprefix_id_to_chars(msg.subprefix_id, &c0, &c1);
-        uint64_t base_idx = msg.subprefix_id * REMSPACE;
+#define POLL_MAX (1u << 16)
+
+// Consulta del canal de control (y progreso). Devuelve 1 si llegó el STOP.
+static int scan_poll(Scan* S, const char* sp, uint64_t r, uint64_t g, uint64_t* hi) {
+    const Config* cfg = S->cfg;
+    const double now = MPI_Wtime();
+    if (cfg->cancel_ms > 0) {
+        const double dt = now - S->t_poll, target = cfg->cancel_ms * 1e-3;
+        if (dt < target / 2 && S->poll_blocks < POLL_MAX) S->poll_blocks *= 2;
+        else if (dt > target * 2 && S->poll_blocks > 1) S->poll_blocks /= 2;
+    }
+    S->t_poll = now;
+    S->blocks_left = S->poll_blocks;
+
+    // progreso periódico
+    const uint64_t checked = (uint64_t)S->met->rec.v[M_candidates];
+    if (cfg->debug && cfg->progress_step && checked >= S->next_progress) {
+        printf("[rank %d] PROGRESS  %s  %" PRIu64 "/%" PRIu64 "  total=%" PRIu64 "  poll=%u lotes\n",
+               S->rank, sp, r, S->REMSPACE, checked, S->poll_blocks);
+        fflush(stdout);
+        while (S->next_progress <= checked) S->next_progress += cfg->progress_step;
+    }
+
+    // ¿STOP o STEAL mientras trabajaba?
+    int flag = 0;
+    MPI_Test(&S->ctl->rq, &flag, MPI_STATUS_IGNORE);
+    if (!flag) return 0;
+    ctrl_handle(S->ctl, g, hi);
+    return S->ctl->got_stop;
+}
+
+// Recorre las posiciones [lo, *hi) de la secuencia de a lotes; *hi baja si le
+// roban o la cancelan, y al volver es hasta dónde llegó. Devuelve 1 si hay que
+// cortar (STOP recibido, o primer hallazgo con --stop_on_first).
+static int scan_range(Scan* S, uint64_t lo, uint64_t* hi) {
+    const Config* cfg = S->cfg;
+    const uint64_t REMSPACE = S->REMSPACE;
+    int cut = 0;
+    uint64_t g = lo;
+    S->t_poll = MPI_Wtime();
+    while (g < *hi && !cut) {
+        const uint64_t p = g / REMSPACE, r0 = g % REMSPACE;
+        const uint64_t sp_id = order_unit(&S->order, p);
+        const int all = S->order.strategy == STRAT_SHUFFLE_ALL;
+        const uint64_t base_idx = sp_id * REMSPACE;
+        char sp[MAX_DEPTH + 1];
+        index_to_base36(sp_id, cfg->depth, sp);
 
         double t0 = MPI_Wtime();
         uint64_t checked = 0, hits = 0;
 
         if (cfg->debug) {
-            printf("[rank %d] ASSIGN  subprefijo=%c%c (id=%" PRIu64 ")  rango=[%" PRIu64 ", %" PRIu64 ")\n",
-                   rank, c0, c1, msg.subprefix_id, base_idx, base_idx + REMSPACE);
+            uint64_t r1 = REMSPACE < r0 + (*hi - g) ? REMSPACE : r0 + (*hi - g);
+            printf("[rank %d] ASSIGN  %s=%s (id=%" PRIu64 ")  rango=[%" PRIu64 ", %" PRIu64 ")\n",
+                   S->rank, all ? "bloque" : "subprefijo", sp, sp_id, base_idx + r0, base_idx + r1);
             fflush(stdout);
         }
 
-        int found_here = 0;
-        for (uint64_t r = 0; r < REMSPACE; ++r) {
-            uint64_t idx = base_idx + r;
-            if (is_target(idx, targets, cfg->n_live)) {
-                ++hits;
-                MPI_Send(&idx, 1, MPI_UINT64_T, 0, TAG_FOUND, MPI_COMM_WORLD);
-                print_found(rank, cfg->prefix, cfg->len, idx);
-                found_here = 1;
-                if (cfg->stop_on_first) break;
-            }
+        for (uint64_t r = r0; r < REMSPACE && g < *hi; ) {
+            uint64_t n = REMSPACE - r;
+            if (n > *hi - g) n = *hi - g;
+            if (n > CAND_BATCH) n = CAND_BATCH;
 
-            ++checked;
-
-            // progreso periódico
-            if (cfg->debug && cfg->progress_step && (checked % cfg->progress_step == 0)) {
-                double pct = (100.0 * (double)checked) / (double)REMSPACE;
-                double dt = MPI_Wtime() - t0;
-                printf("[rank %d] PROGRESS  %c%c  %" PRIu64 "/%" PRIu64 " (%.2f%%)  t=%.2fs\n",
-                       rank, c0, c1, checked, REMSPACE, pct, dt);
-                fflush(stdout);
+            if (all) {
+                for (uint64_t i = 0; i < n; ++i) S->cand[i] = perm_apply(&S->order.perm, g + i);
+                batch_fill_list(&S->cb, cfg->len, S->cand, (int)n);
+            } else {
+                batch_fill(&S->cb, cfg->len, base_idx + r, (int)n);
+            }
+            const int k = S->pred->test(S->pred, &S->cb, S->hit);
+            for (int j = 0; j < k; ++j) {
+                uint64_t idx = all ? S->cand[S->hit[j]] : base_idx + r + (uint64_t)S->hit[j];
+                ++hits;
+                S->met->rec.v[M_hits]++;
+                S->report[3 + S->report[2]++] = idx;
+                if (S->report[2] == HIT_BATCH) {
+                    // no entran más en el TAG_DONE: este lote sale ya
+                    MPI_Send(&S->report[2], 1 + HIT_BATCH, MPI_UINT64_T, 0, TAG_FOUND, S->ctl->comm);
+                    S->report[2] = 0;
+                }
+                if (cfg->stop_on_first) { n = (uint64_t)S->hit[j] + 1; cut = 1; break; }
             }
 
-            // ¿STOP mientras trabajaba?
-            int flag_stop = 0;
-            MPI_Iprobe(0, TAG_STOP, MPI_COMM_WORLD, &flag_stop, &st);
-            if (flag_stop) { int tmp; MPI_Recv(&tmp, 1, MPI_INT, 0, TAG_STOP, MPI_COMM_WORLD, MPI_STATUS_IGNORE); break; }
+            r += n; g += n;
+            checked += n;
+            S->met->rec.v[M_candidates] += (double)n;
+            if (cut) break;
+            if (--S->blocks_left == 0 && scan_poll(S, sp, r, g, hi)) { cut = 1; break; }
         }
 
         double dt = MPI_Wtime() - t0;
+        S->met->rec.v[M_compute_s] += dt;
+        met_event(S->met, EV_SCAN, t0, dt, base_idx + r0, checked);
         if (cfg->debug) {
-            double pct = (100.0 * (double)checked) / (double)REMSPACE;
-            printf("[rank %d] DONE     subprefijo=%c%c  checked=%" PRIu64 "/%" PRIu64 " (%.2f%%)  hits=%" PRIu64 "  time=%.2fs\n",
-                   rank, c0, c1, checked, REMSPACE, pct, hits, dt);
+            printf("[rank %d] DONE     subprefijo=%s  checked=%" PRIu64 "  hits=%" PRIu64 "  time=%.2fs\n",
+                   S->rank, sp, checked, hits, dt);
             fflush(stdout);
         }
+    }
+    *hi = g;
+    return cut;
+}
+
+static void run_worker(const Config* cfg, MPI_Comm comm, int rank, const Predicate* pred, Metrics* met) {
+    AssignMsg cur, next;
+    MPI_Request rq[2];
+    Ctrl ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.comm = comm; ctl.rq = MPI_REQUEST_NULL; ctl.lease = NO_LEASE; ctl.met = met;
+    int stop = 0;
 
-        if (cfg->stop_on_first && found_here) break;
+    Scan S;
+    memset(&S, 0, sizeof(S));
+    S.cfg = cfg; S.pred = pred; S.ctl = &ctl; S.rank = rank; S.met = met;
+    make_order(&S.order, cfg);
+    S.REMSPACE = powu(RADIX, cfg->len - cfg->depth);
+    S.poll_blocks = S.blocks_left = 1;
+    S.next_progress = cfg->progress_step;
+    batch_init(&S.cb, cfg, pred->needs_text);
+
+    ctrl_post(&ctl);
+    post_request(comm, &next, rq);
+    while (1) {
+        wait_assign(&ctl, rq);
+        cur = next;
+        if (!cur.valid) break;
+        met->rec.v[M_tasks]++;
+
+        // doble buffer: el próximo lote se pide antes de computar este. Después de
+        // un STOP se siguen pidiendo (sin computar) hasta la asignación inválida.
+        // Toda tarea se cierra con TAG_DONE { lease, hasta dónde llegó, hallazgos }.
+        post_request(comm, &next, rq);
+        S.report[0] = cur.lease;
+        S.report[1] = cur.first;
+        if (!stop && !ctl.got_stop && !ctrl_skipped(&ctl, cur.lease)) {
+            uint64_t hi = cur.first + cur.count;
+            ctl.lease = cur.lease;
+            stop = scan_range(&S, cur.first, &hi);
+            ctl.lease = NO_LEASE;
+            S.report[1] = hi;
+        }
+        MPI_Send(S.report, (int)(3 + S.report[2]), MPI_UINT64_T, 0, TAG_DONE, comm);
+        S.report[2] = 0;
+    }
+    if (cur.stopped) {
+        while (!ctl.got_stop) {
+            MPI_Wait(&ctl.rq, MPI_STATUS_IGNORE);
+            ctrl_handle(&ctl, 0, NULL);
+        }
+    } else if (ctl.rq != MPI_REQUEST_NULL) {
+        MPI_Cancel(&ctl.rq);
+        MPI_Wait(&ctl.rq, MPI_STATUS_IGNORE);
     }
+    uint64_t end = FOUND_END;
+    MPI_Send(&end, 1, MPI_UINT64_T, 0, TAG_FOUND, comm);
+    free(S.cb.text);
+    met->rec.v[M_idle_s] = MPI_Wtime() - met->t0 - met->rec.v[M_compute_s];
+}
+
+// Hilo ayudante de cada maestro (--master_work 1): el mismo trabajador, hablando con
+// el maestro por mensajes a sí mismo (requiere MPI_THREAD_MULTIPLE)
+typedef struct {
+    const Config* cfg;
+    MPI_Comm comm;
+    int rank;
+    const Predicate* pred;
+    Metrics* met;
+} HelperArg;
+
+static void* helper_main(void* arg) {
+    const HelperArg* h = (const HelperArg*)arg;
+    run_worker(h->cfg, h->comm, h->rank, h->pred, h->met);
+    return NULL;
 }
 
 // ---------------- main ----------------
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    // --master_work se mira antes de MPI_Init: decide el nivel de hilos que se pide
+    int want_mt = 0;
+    for (int i = 1; i + 1 < argc; ++i) if (!strcmp(argv[i], "--master_work")) want_mt = atoi(argv[i+1]);
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, want_mt ? MPI_THREAD_MULTIPLE : MPI_THREAD_SINGLE, &provided);
 
     int rank=0, world=1;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world);
 
-    if (world < 2 && rank == 0)
-        fprintf(stderr, "Se necesitan al menos 2 procesos (1 maestro + 1 trabajador)\n");
-
     Config cfg;
     parse_args(argc, argv, &cfg);
 
+    if (cfg.master_work && provided < MPI_THREAD_MULTIPLE) {
+        if (rank == 0) fprintf(stderr, "MPI sin MPI_THREAD_MULTIPLE: --master_work desactivado\n");
+        cfg.master_work = 0;
+    }
+    if (world < 2 && !cfg.master_work && rank == 0)
+        fprintf(stderr, "Se necesitan al menos 2 procesos (1 maestro + 1 trabajador) o --master_work 1\n");
+    if (cfg.hier && cfg.hier_group == 1 && !cfg.master_work && rank == 0)
+        fprintf(stderr, "--hier_group 1 sin --master_work 1: no queda ningún trabajador\n");
+
     uint64_t total = powu(RADIX, cfg.len);
-    uint64_t* targets = make_targets(total, cfg.n_live, cfg.seed);
+    TargetSet ts;
+    if (cfg.depth == 0) cfg.depth = auto_depth(cfg.len, world);
+    make_targets(&ts, total, cfg.n_live, cfg.seed, powu(RADIX, cfg.depth));
+    Predicate pred;
+    make_predicate(&pred, &cfg, &ts);
+
+    // --hier 1: 'local' agrupa los ranks de un nodo (o de a --hier_group) y su
+    // rank 0 es el sub-maestro; 'leaders' une a los sub-maestros con la raíz
+    // (rank 0 del mundo, que es rank 0 en ambos por usar el rank como clave)
+    MPI_Comm local = MPI_COMM_WORLD, leaders = MPI_COMM_NULL;
+    if (cfg.hier) {
+        if (cfg.hier_group > 0)
+            MPI_Comm_split(MPI_COMM_WORLD, rank / cfg.hier_group, rank, &local);
+        else
+            MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &local);
+    }
+    int lrank = rank;
+    MPI_Comm_rank(local, &lrank);
+    if (cfg.hier)
+        MPI_Comm_split(MPI_COMM_WORLD, lrank == 0 ? 0 : MPI_UNDEFINED, rank, &leaders);
 
-    if (rank == 0) run_master(&cfg, world, total, targets);
-    else           run_worker(&cfg, rank, total, targets);
+    // origen común de tiempos: todos salen de la misma barrera
+    MPI_Barrier(MPI_COMM_WORLD);
+    const double t0 = MPI_Wtime();
+    const int trace = cfg.trace != NULL;
+    Metrics met, hmet;          // hmet: hilo ayudante (--master_work)
+    memset(&hmet, 0, sizeof(hmet));
+    Metrics* ms[2] = { &met, &hmet };
+    int nm = 1;
+    Sink sink;                  // hallazgos (solo la raíz)
+    if (rank == 0) sink_open(&sink, &cfg);
+    if (lrank == 0) {
+        met_init(&met, rank, 0, rank == 0 ? ROLE_MASTER : ROLE_SUBMASTER, trace, t0);
+        met_init(&hmet, rank, 1, ROLE_WORKER, trace, t0);
+        pthread_t helper;
+        HelperArg ha = { &cfg, local, rank, &pred, &hmet };
+        if (cfg.master_work && pthread_create(&helper, NULL, helper_main, &ha)) die("pthread_create");
+        run_master(&cfg, local, leaders, world, &ts, cfg.master_work, &met, rank == 0 ? &sink : NULL);
+        if (cfg.master_work) { pthread_join(helper, NULL); nm = 2; }
+    } else {
+        met_init(&met, rank, 0, ROLE_WORKER, trace, t0);
+        run_worker(&cfg, local, rank, &pred, &met);
+    }
+    const double dt = MPI_Wtime() - t0;
+    if (rank == 0) sink_close(&sink);
+
+    MetRec* recs = NULL;
+    Event* evs = NULL;
+    int nrec = 0;
+    uint64_t nev = 0;
+    met_gather(ms, nm, trace, &recs, &nrec, &evs, &nev);
+    if (rank == 0) {
+        // rendimiento: hostnames evaluados por todos / tiempo hasta que termina el maestro
+        double checked_all = 0, busy_all = 0;
+        for (int i = 0; i < nrec; ++i) { checked_all += recs[i].v[M_candidates]; busy_all += recs[i].v[M_compute_s]; }
+        printf("[master] %.0f hostnames en %.3fs (%.3g hostnames/s, %.3g por núcleo ocupado, predicado %s)\n",
+               checked_all, dt, dt > 0 ? checked_all / dt : 0.0,
+               busy_all > 0 ? checked_all / busy_all : 0.0, pred.name);
+        // cobertura según las tablas de tareas: lo recorrido por alguna copia más lo
+        // recorrido de más tiene que dar exactamente lo que evaluaron los trabajadores
+        double cov[M_COUNT] = { 0 };
+        for (int i = 0; i < nrec; ++i)
+            for (int j = M_covered; j <= M_cancelled; ++j) cov[j] += recs[i].v[j];
+        printf("[master] cobertura: %.0f de %" PRIu64 " candidatos (%.2f%%), %.0f recorridos de más, "
+               "%.0f tareas re-emitidas, %.0f canceladas\n",
+               cov[M_covered], total, 100.0 * cov[M_covered] / (double)total, cov[M_wasted],
+               cov[M_reissued], cov[M_cancelled]);
+        if (cov[M_covered] + cov[M_wasted] != checked_all)
+            fprintf(stderr, "[master] AVISO: las tareas cubren %.0f + %.0f pero se evaluaron %.0f candidatos\n",
+                    cov[M_covered], cov[M_wasted], checked_all);
+        if (!cfg.stop_on_first && cov[M_covered] != (double)total)
+            fprintf(stderr, "[master] AVISO: cobertura incompleta\n");
+        printf("[master] %" PRIu64 " hallazgos%s%s (%" PRIu64 " repetidos descartados)\n",
+               sink.n, cfg.out ? " en " : "", cfg.out ? cfg.out : "", sink.dup);
+        fflush(stdout);
+        if (cfg.metrics) met_write_json(cfg.metrics, recs, nrec, world, dt);
+        if (cfg.trace) met_write_trace(cfg.trace, recs, nrec, evs, nev);
+    }
+    free(recs); free(evs);
+    free(met.ev); free(hmet.ev);
 
-    free(targets);
+    if (leaders != MPI_COMM_NULL) MPI_Comm_free(&leaders);
+    if (local != MPI_COMM_WORLD) MPI_Comm_free(&local);
+    free_predicate(&pred);
+    free_targets(&ts);
     MPI_Finalize();
     return 0;
 }
\ No newline at end of file
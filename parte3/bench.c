@@ -0,0 +1,296 @@
+// bench.c — claves/seg del camino de brute de bruteforce.c (salida JSON)
+//
+// Compilar:
+//   make bench        (o: mpicc -O3 -pthread -DOPENSSL_API_COMPAT=0x10100000L bench.c -o bench -lcrypto -lm)
+//
+// Uso:
+//   mpirun -np 4 ./bench [-threads 4] [-strong_bits 22] [-weak_bits 18] [-time 0.3] [-o bench.json]
+//
+// 1) Micro (rank 0, un hilo): tirpc_make_key, key schedule (completo e incremental),
+//    un bloque DES, tryKey, kpa_try, los matchers de crib y cada kernel bitslice soportado.
+// 2) Escalado con el motor real (cola RMA + hilos): para cada P ranks (1,2,4..np)
+//    y T hilos (1,2,4..threads) una corrida fuerte (2^strong_bits claves en total) y
+//    una débil (2^weak_bits claves por hilo). La eficiencia es contra P=1,T=1.
+//
+// El crib nunca aparece, así que siempre se recorre el rango entero.
+
+#define BRUTEFORCE_NO_MAIN
+#pragma GCC diagnostic ignored "-Wunused-function"   // lo que solo usa el main de bruteforce
+#include "bruteforce.c"
+
+static volatile uint64_t bench_sink;
+
+typedef struct {
+    char name[32];
+    double ns;        // ns por operación
+    double unit;      // claves o bytes por operación
+    const char* per;  // "key" | "byte"
+} Micro;
+
+// Cronometra el cuerpo (con i = número de iteración) en tandas hasta juntar tmin segundos
+#define BENCH_LOOP(tmin, nops, secs, ...) do {                      \
+        uint64_t n_ = 0, step_ = 64;                                \
+        double t0_ = MPI_Wtime(), t_;                               \
+        do {                                                        \
+            for (uint64_t i = n_; i < n_ + step_; i++){ __VA_ARGS__; } \
+            n_ += step_;                                            \
+            if (step_ < (1u<<20)) step_ *= 2;                       \
+            t_ = MPI_Wtime() - t0_;                                 \
+        } while (t_ < (tmin));                                      \
+        (nops) = n_; (secs) = t_;                                   \
+    } while (0)
+
+static void micro_add(Micro* m, int* nm, const char* name, uint64_t ops, double secs, double unit, const char* per){
+    Micro* x = &m[(*nm)++];
+    snprintf(x->name, sizeof(x->name), "%s", name);
+    x->ns = secs * 1e9 / (double)ops;
+    x->unit = unit;
+    x->per = per;
+}
+
+// ====== Motor completo sobre [0, nkeys) en comm con 'threads' hilos; devuelve segundos ======
+static double bench_engine(MPI_Comm comm, int threads, const BsKernel* kern,
+                           const unsigned char* ct, int len, const TryCtx* tc, int bs_len,
+                           uint64_t nkeys, uint64_t chunk){
+    int id; MPI_Comm_rank(comm, &id);
+    uint64_t L = kern ? (uint64_t)kern->lanes : 1;
+    chunk = (chunk + L - 1) / L * L;
+    RangeList todo = {0};
+    rl_add(&todo, 0, nkeys - 1);
+    Sched sched;
+    sched_build(&sched, &todo, chunk, L, nkeys - 1);
+    rl_free(&todo);
+
+    WorkQueue q;
+    wq_init(&q, comm, id, 0, 0);
+    Engine E;
+    memset(&E, 0, sizeof(E));
+    E.q = &q; E.sched = &sched;
+    E.align = L;
+    E.grain = (GRAIN_KEYS + L - 1) / L * L;
+    E.nthreads = threads;
+    pthread_mutex_init(&E.mpi_lock, NULL);
+    atomic_init(&E.stop, 0);
+    E.dq = (RangeDeque*)calloc((size_t)threads, sizeof(RangeDeque));
+    Worker* W = (Worker*)calloc((size_t)threads, sizeof(Worker));
+    pthread_t* th = (pthread_t*)calloc((size_t)threads, sizeof(pthread_t));
+    if (!E.dq || !W || !th) die("mem");
+    for (int t=0;t<threads;t++){
+        pthread_mutex_init(&E.dq[t].m, NULL);
+        Worker* w = &W[t];
+        w->E = &E; w->tid = t;
+        w->tc = *tc;
+        if (kern && !bs_ctx_init(&w->bs, kern, tc->crib, tc->crib_len)) die("mem");
+        Search S = { ct, len, &w->tc, kern, &w->bs, bs_len, NULL, NULL, NULL, NULL, NULL };
+        w->S = S;
+    }
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    for (int t=1;t<threads;t++)
+        if (pthread_create(&th[t], NULL, worker_main, &W[t])) die("pthread_create");
+    worker_main(&W[0]);
+    for (int t=1;t<threads;t++) pthread_join(th[t], NULL);
+    MPI_Barrier(comm);
+    double secs = MPI_Wtime() - t0;
+
+    wq_free(&q);
+    for (int t=0;t<threads;t++){
+        if (kern) bs_ctx_free(&W[t].bs);
+        pthread_mutex_destroy(&E.dq[t].m);
+    }
+    pthread_mutex_destroy(&E.mpi_lock);
+    free(W); free(E.dq); free(th);
+    free(E.fl_c); free(E.fl_left);
+    sched_free(&sched);
+    return secs;
+}
+
+int main(int argc, char *argv[]){
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+    int N=1, id=0;
+    MPI_Comm_size(MPI_COMM_WORLD, &N);
+    MPI_Comm_rank(MPI_COMM_WORLD, &id);
+
+    int threads=1, strong_bits=22, weak_bits=18;
+    double tmin=0.3;
+    const char* out_path=NULL, *kernel_name="auto";
+    uint64_t chunk=DEFAULT_CHUNK;
+    for (int i=1;i<argc;i++){
+        if (!strcmp(argv[i],"-threads") && i+1<argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-strong_bits") && i+1<argc) strong_bits = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-weak_bits") && i+1<argc) weak_bits = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-time") && i+1<argc) tmin = atof(argv[++i]);
+        else if (!strcmp(argv[i],"-o") && i+1<argc) out_path = argv[++i];
+        else if (!strcmp(argv[i],"-kernel") && i+1<argc) kernel_name = argv[++i];
+        else if (!strcmp(argv[i],"-chunk") && i+1<argc) chunk = strtoull(argv[++i], NULL, 10);
+    }
+    if (threads < 1) threads = 1;
+    if (provided < MPI_THREAD_SERIALIZED) threads = 1;
+    if (strong_bits < 8 || strong_bits > 40 || weak_bits < 8 || weak_bits > 40) die("-strong_bits/-weak_bits fuera de rango (8..40)");
+
+    // Ciphertext de prueba: BEN10 con una clave cualquiera; crib que no aparece
+    int len = (int)(sizeof(BEN10_PLAIN)-1) / BLK * BLK;
+    unsigned char* ct = (unsigned char*)malloc((size_t)len);
+    if (!ct) die("mem");
+    memcpy(ct, BEN10_PLAIN, (size_t)len);
+    tirpc_ecb_crypt(0x5A5A5AULL, ct, len, 1);
+    static const unsigned char miss[] = "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10";
+    const int miss_len = 16;
+    TryCtx tc;
+    try_ctx_init(&tc, miss, miss_len, 16);   // -scan 16: ventana corta, como un brute típico
+    int bs_len = (try_scan_len(&tc, len) + BLK - 1) / BLK * BLK;
+
+    const BsKernel* best = NULL;
+    if (strcmp(kernel_name,"scalar")){
+        best = bs_select(kernel_name);
+        if (!best) die("Kernel no soportado (use auto|scalar|u64|sse2|avx2|avx512)");
+    }
+
+    FILE* out = stdout;
+    if (id==0 && out_path){
+        out = fopen(out_path, "w");
+        if (!out) die("No pude abrir -o");
+    }
+
+    // ================= Micro (rank 0) =================
+    Micro m[32]; int nm = 0;
+    if (id==0){
+        uint64_t ops; double secs;
+        unsigned char k8[8];
+        DES_key_schedule ks;
+        DES_cblock blk;
+        memcpy(blk, ct, BLK);
+
+        BENCH_LOOP(tmin, ops, secs, { tirpc_make_key(i, k8); bench_sink += k8[0]; });
+        micro_add(m, &nm, "tirpc_make_key", ops, secs, 1, "key");
+
+        BENCH_LOOP(tmin, ops, secs, { tirpc_key_schedule(i, &ks); bench_sink += ks.ks[0].deslong[0]; });
+        micro_add(m, &nm, "key_schedule", ops, secs, 1, "key");
+
+        KeyWalk kw;
+        kw_start(&kw, 0);
+        BENCH_LOOP(tmin, ops, secs, { kw_next(&kw); bench_sink += kw.s.w[0]; });
+        micro_add(m, &nm, "key_schedule_incremental", ops, secs, 1, "key");
+
+        tirpc_key_schedule(12345, &ks);
+        BENCH_LOOP(tmin, ops, secs, { DES_ecb_encrypt(&blk, &blk, &ks, DES_DECRYPT); });
+        bench_sink += blk[0];
+        micro_add(m, &nm, "des_block", ops, secs, 1, "key");
+
+        TryCtx t1 = tc;
+        BENCH_LOOP(tmin, ops, secs, { bench_sink += tryKey(i, ct, len, &t1); });
+        micro_add(m, &nm, "tryKey", ops, secs, 1, "key");
+
+        KpaCtx kc;
+        kpa_ctx_init(&kc, ct, len, miss, miss_len, 0);
+        kw_start(&kw, 0);
+        BENCH_LOOP(tmin, ops, secs, { bench_sink += kpa_try_ks(&kc, &kw.s.ks); kw_next(&kw); });
+        micro_add(m, &nm, "kpa_try", ops, secs, 1, "key");
+        kpa_ctx_free(&kc);
+
+        // matchers sobre un texto plano de 4 KiB
+        enum { TXT = 4096 };
+        unsigned char* txt = (unsigned char*)malloc(TXT);
+        if (!txt) die("mem");
+        for (int i=0;i<TXT;i++) txt[i] = (unsigned char)BEN10_PLAIN[i % (int)(sizeof(BEN10_PLAIN)-1)];
+        BENCH_LOOP(tmin, ops, secs, { bench_sink += memmem_naive(txt, TXT, miss, miss_len); });
+        micro_add(m, &nm, "memmem_naive", ops, secs, TXT, "byte");
+
+        CribList cl = {0};
+        static const char* words[] = { "secreto", "password", "usuario", "HTTP/1.1", "Content-Type",
+                                       "the ", " and ", " de la ", " que ", "Andres", "BEGIN", "-----",
+                                       "\x01\x02\x03", "Ben 10 xx", "qwertyuiop", "admin" };
+        for (int i=0;i<16;i++) crib_list_add(&cl, (const unsigned char*)words[i], (int)strlen(words[i]));
+        AcAuto ac;
+        ac_build(&ac, &cl);
+        BENCH_LOOP(tmin, ops, secs, {
+            int st = 0; uint64_t seen = 0;
+            for (int j=0;j<TXT;j++){ st = ac.go[st][txt[j]]; seen |= ac.out[st]; }
+            bench_sink += seen;
+        });
+        micro_add(m, &nm, "aho_corasick_16", ops, secs, TXT, "byte");
+        ac_free(&ac);
+        crib_list_free(&cl);
+
+        BENCH_LOOP(tmin, ops, secs, { bench_sink += text_bytes(txt, TXT); });
+        micro_add(m, &nm, "text_bytes", ops, secs, TXT, "byte");
+        BENCH_LOOP(tmin, ops, secs, { bench_sink += (uint64_t)shannon_entropy(txt, TXT); });
+        micro_add(m, &nm, "shannon_entropy", ops, secs, TXT, "byte");
+        free(txt);
+
+        // kernels bitslice: una pasada = 'lanes' claves
+        int nk = (int)(sizeof(BS_KERNELS)/sizeof(BS_KERNELS[0]));
+        for (int k=0;k<nk;k++){
+            const BsKernel* kern = &BS_KERNELS[k];
+            if (!bs_kernel_supported(kern)) continue;
+            BsCtx bs;
+            uint64_t hit[BS_MAX_WORDS];
+            if (!bs_ctx_init(&bs, kern, miss, miss_len)) die("mem");
+            BENCH_LOOP(tmin, ops, secs, { bench_sink += kern->try_keys(&bs, i * (uint64_t)kern->lanes, ct, bs_len, hit); });
+            char name[32];
+            snprintf(name, sizeof(name), "bitslice_%s", kern->name);
+            micro_add(m, &nm, name, ops, secs, kern->lanes, "key");
+            bs_ctx_free(&bs);
+        }
+    }
+
+    // ================= Escalado =================
+    typedef struct { const char* kind; int p, t; uint64_t keys; double secs; } Run;
+    Run runs[256]; int nr = 0;
+    for (int p=1; ; p = (p*2 > N && p < N) ? N : p*2){
+        MPI_Comm sub;
+        MPI_Comm_split(MPI_COMM_WORLD, id < p ? 0 : MPI_UNDEFINED, id, &sub);
+        for (int t=1; ; t = (t*2 > threads && t < threads) ? threads : t*2){
+            for (int weak=0; weak<2; weak++){
+                uint64_t keys = weak ? ((uint64_t)p * (uint64_t)t) << weak_bits : 1ULL << strong_bits;
+                double secs = 0;
+                if (sub != MPI_COMM_NULL)
+                    secs = bench_engine(sub, t, best, ct, len, &tc, bs_len, keys, chunk);
+                MPI_Barrier(MPI_COMM_WORLD);
+                if (id==0 && nr < 256){
+                    Run r = { weak ? "weak" : "strong", p, t, keys, secs };
+                    runs[nr++] = r;
+                    fprintf(stderr, "%-6s P=%d T=%d: %.3f s\n", r.kind, p, t, secs);
+                }
+            }
+            if (t >= threads) break;
+        }
+        if (sub != MPI_COMM_NULL) MPI_Comm_free(&sub);
+        if (p >= N) break;
+    }
+
+    // ================= JSON =================
+    if (id==0){
+        char host[256] = "?";
+        gethostname(host, sizeof(host));
+        fprintf(out, "{\n  \"host\": \"%s\",\n  \"ranks\": %d,\n  \"threads\": %d,\n  \"kernel\": \"%s\",\n  \"time_per_micro\": %.3f,\n",
+                host, N, threads, best ? best->name : "scalar", tmin);
+        fprintf(out, "  \"micro\": [\n");
+        for (int i=0;i<nm;i++){
+            double per_sec = 1e9 / m[i].ns * m[i].unit;
+            fprintf(out, "    {\"name\": \"%s\", \"ns_per_call\": %.3f, \"ns_per_%s\": %.4f, \"%ss_per_sec\": %.1f}%s\n",
+                    m[i].name, m[i].ns, m[i].per, m[i].ns / m[i].unit, m[i].per, per_sec, i+1<nm ? "," : "");
+        }
+        fprintf(out, "  ],\n  \"scaling\": [\n");
+        double base[2] = {0, 0};   // P=1,T=1 fuerte / débil
+        for (int i=0;i<nr;i++)
+            if (runs[i].p == 1 && runs[i].t == 1) base[runs[i].kind[0]=='w'] = runs[i].secs;
+        for (int i=0;i<nr;i++){
+            Run* r = &runs[i];
+            int w = r->kind[0]=='w';
+            double eff = (r->secs > 0) ? (w ? base[1] / r->secs : base[0] / (r->secs * r->p * r->t)) : 0;
+            fprintf(out, "    {\"kind\": \"%s\", \"ranks\": %d, \"threads\": %d, \"keys\": %llu, \"seconds\": %.6f, "
+                         "\"keys_per_sec\": %.1f, \"ns_per_key\": %.4f, \"efficiency\": %.4f}%s\n",
+                    r->kind, r->p, r->t, (unsigned long long)r->keys, r->secs,
+                    r->keys / r->secs, r->secs * 1e9 / r->keys, eff, i+1<nr ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        if (out != stdout) fclose(out);
+    }
+
+    free(ct);
+    MPI_Finalize();
+    return 0;
+}
@@ -2,7 +2,7 @@
 //
 // Compilar (Ubuntu/WSL):
 //   sudo apt-get install -y libopenmpi-dev openmpi-bin libssl-dev
-//   mpicc bruteforce.c -o bruteforce -lcrypto
+//   mpicc -O3 -pthread -DOPENSSL_API_COMPAT=0x10100000L bruteforce.c -o bruteforce -lcrypto -lm
 //
 // Ejemplos:
 //   # 1) Encriptar BEN10 interno -> ct.hex (texto) y convertir a bin
@@ -18,13 +18,28 @@
 //   # 4) Brute sobre bytes del compa con crib
 //   BYTES="{241, 49, 35, 6, 25, 159, 151, 68, 69, 50, 237, 92, 45, 89, 154, 75, 134, 19, 232, 4, 94, 205, 139, 65, 80, 251, 236, 242, 243, 42, 181, 34, 218, 125, 137, 244, 95, 150, 190, 120}"
 //   mpirun -np 2 ./bruteforce -mode brute -bytes "$BYTES" -crib " Andres " -bits 24
+//
+//   # 5) Forzar el kernel de brute (auto | scalar | u64 | sse2 | avx2 | avx512)
+//   mpirun -np 2 ./bruteforce -mode brute -in ct.bin -crib " secretos " -bits 32 -kernel avx2
+//
+//   # 6) Un rank por nodo con 8 hilos (o sin mpirun: ./bruteforce -mode brute ... -threads 8)
+//   mpirun -np 2 --map-by ppr:1:node --bind-to none ./bruteforce -mode brute -in ct.bin -crib " secretos " -bits 32 -threads 8
 
+#define _GNU_SOURCE // pthread_setaffinity_np / CPU_SET
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // ---------- Shim de compatibilidad TI-RPC usando OpenSSL DES ----------
 #include <openssl/des.h>
@@ -61,8 +76,12 @@ static int ecb_crypt(char *k8, char *buf, unsigned len, unsigned mode) {
 }
 // ---------------------------------------------------------------------
 
+#include "des_bs.h"
+
 #define BLK 8
-#define MAXB (1<<20) // 1 MiB
+#define STREAM_CHUNK (1<<16) // bytes por tanda al cifrar/descifrar en streaming
+#define DEFAULT_CHUNK (1ULL<<16) // claves por bloque reclamado (se revisa la parada entre bloques)
+#define KEY56_MASK ((1ULL<<56)-1ULL)
 
 // ====== Plaintext BEN10 interno (múltiplo de 8, sin padding) ======
 static const unsigned char BEN10_PLAIN[] =
@@ -136,175 +155,2147 @@ static int from_bytes_list(const char* s, unsigned char* out, int max){
     return n;
 }
 
-static int read_file(const char* path, unsigned char* buf, int max){
-    FILE* f=fopen(path,"rb"); if(!f) return -1;
-    int n=(int)fread(buf,1,max,f); fclose(f); return n;
+// Entrada: archivo mapeado (mmap) o bytes en heap (-hex/-bytes). El archivo no se
+// copia nunca entero: encrypt/decrypt lo recorren por tandas y brute solo manda
+// a los demás ranks el prefijo que necesita el predicado.
+typedef struct {
+    const unsigned char* p;
+    size_t n;
+    void* map;              // mmap (o NULL)
+    size_t map_len;
+    unsigned char* heap;    // -hex/-bytes, o archivo que no se puede mapear (pipe)
+} Input;
+
+static int input_file(Input* in, const char* path){
+    memset(in, 0, sizeof(*in));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)){
+        in->p = (const unsigned char*)"";
+        if (st.st_size > 0){
+            void* m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m == MAP_FAILED){ close(fd); return -1; }
+            madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+            in->map = m; in->map_len = (size_t)st.st_size;
+            in->p = (const unsigned char*)m; in->n = (size_t)st.st_size;
+        }
+        close(fd);
+        return 0;
+    }
+    // pipe o dispositivo: se lee entero a memoria
+    size_t cap = 1<<16;
+    in->heap = (unsigned char*)malloc(cap);
+    if (!in->heap){ close(fd); return -1; }
+    for (;;){
+        if (in->n == cap){
+            cap *= 2;
+            unsigned char* t = (unsigned char*)realloc(in->heap, cap);
+            if (!t){ close(fd); return -1; }
+            in->heap = t;
+        }
+        ssize_t r = read(fd, in->heap + in->n, cap - in->n);
+        if (r < 0){ close(fd); return -1; }
+        if (r == 0) break;
+        in->n += (size_t)r;
+    }
+    close(fd);
+    in->p = in->heap;
+    return 0;
+}
+
+// -hex / -bytes: el buffer se dimensiona según el argumento
+static int input_text(Input* in, const char* s, int is_hex){
+    memset(in, 0, sizeof(*in));
+    int cap = (int)strlen(s) + 1;
+    in->heap = (unsigned char*)malloc((size_t)cap);
+    if (!in->heap) return -1;
+    int n = is_hex ? from_hex(s, in->heap, cap) : from_bytes_list(s, in->heap, cap);
+    if (n < 0) return -1;
+    in->p = in->heap; in->n = (size_t)n;
+    return 0;
 }
 
-static void print_hex(const unsigned char* b, int n){
-    for (int i=0;i<n;i++) printf("%02x", b[i]);
-    printf("\n");
+static void input_static(Input* in, const unsigned char* p, size_t n){
+    memset(in, 0, sizeof(*in));
+    in->p = p; in->n = n;
+}
+
+static void input_close(Input* in){
+    if (in->map) munmap(in->map, in->map_len);
+    free(in->heap);
+    memset(in, 0, sizeof(*in));
+}
+
+static void write_hex(FILE* out, const unsigned char* b, size_t n){
+    static const char hx[] = "0123456789abcdef";
+    char line[2*4096];
+    for (size_t i=0;i<n;){
+        size_t m = 0;
+        for (; i<n && m<sizeof(line); i++){ line[m++] = hx[b[i]>>4]; line[m++] = hx[b[i]&15]; }
+        fwrite(line, 1, m, out);
+    }
 }
 
 // ================= Crib matching =================
 static int memmem_naive(const unsigned char* hay, int hlen, const unsigned char* ndl, int nlen){
     if (nlen<=0 || hlen<=0 || nlen>hlen) return 0;
     for (int i=0;i<=hlen-nlen;i++){
-        if (memcmp(hay+i, ndl, nlen)==0) return 1;
+        if (hay[i]==ndl[0] && memcmp(hay+i, ndl, nlen)==0) return 1;
     }
     return 0;
 }
 
-static int contains_crib_any(const unsigned char* p, int n,
-                             const char* crib_text,
-                             const unsigned char* crib_bytes, int crib_bytes_len){
-    if (crib_bytes && crib_bytes_len>0){
-        return memmem_naive(p, n, crib_bytes, crib_bytes_len);
+// ================= Cribs: límites y varios cribs (Aho-Corasick) =================
+// El crib de texto se compara como bytes (igual que -cribhex): strstr no veía
+// coincidencias después de un byte 0 del texto plano.
+#define CRIB_MAX 512
+
+// -cribs FILE: un crib por línea (texto tal cual, o "hex:..." para bytes). El
+// autómata se recorre byte a byte sobre el texto plano a medida que se descifra,
+// así que el costo no depende de cuántos cribs haya. Cada estado guarda en una
+// máscara de 64 bits qué cribs terminan ahí (el score cuenta cribs distintos), así
+// que se admiten hasta AC_MAX_PAT.
+#define AC_MAX_PAT 64
+typedef struct {
+    int32_t (*go)[256];   // transición completa (DFA)
+    uint64_t* out;        // cribs que terminan en el estado (bit id), con sufijos
+    int nstates, npat;
+} AcAuto;
+
+typedef struct {
+    unsigned char* data;  // cribs concatenados
+    int* off;             // crib i = data[off[i] .. off[i+1])
+    int n, size;
+} CribList;
+
+static void crib_list_add(CribList* cl, const unsigned char* b, int len){
+    if (len > CRIB_MAX) die("crib demasiado largo (max 512 bytes)");
+    cl->data = (unsigned char*)realloc(cl->data, (size_t)(cl->size + len + 1));
+    cl->off = (int*)realloc(cl->off, sizeof(int) * (size_t)(cl->n + 2));
+    if (!cl->data || !cl->off) die("mem");
+    if (cl->n == 0) cl->off[0] = 0;
+    memcpy(cl->data + cl->size, b, (size_t)len);
+    cl->size += len;
+    cl->off[++cl->n] = cl->size;
+}
+
+static void crib_list_load(const char* path, CribList* cl){
+    FILE* f = fopen(path, "r");
+    if (!f) die("No pude leer -cribs");
+    char line[2*CRIB_MAX + 16];
+    unsigned char b[CRIB_MAX];
+    while (fgets(line, sizeof(line), f)){
+        size_t L = strlen(line);
+        while (L && (line[L-1]=='\n' || line[L-1]=='\r')) line[--L] = 0;
+        if (!L) continue;
+        if (cl->n == AC_MAX_PAT) die("-cribs: demasiados cribs (max 64)");
+        if (!strncmp(line, "hex:", 4)){
+            int n = from_hex(line+4, b, CRIB_MAX);
+            if (n <= 0) die("-cribs: hex invalido");
+            crib_list_add(cl, b, n);
+        } else {
+            crib_list_add(cl, (const unsigned char*)line, (int)L);
+        }
     }
-    if (crib_text && *crib_text){
-        char *tmp = (char*)malloc(n+1);
-        if (!tmp) return 0;
-        memcpy(tmp, p, n); tmp[n]=0;
-        int ok = strstr(tmp, crib_text) != NULL;
-        free(tmp);
-        return ok;
+    fclose(f);
+}
+
+static void crib_list_bcast(CribList* cl, int id){
+    int hdr[2] = { cl->n, cl->size };
+    MPI_Bcast(hdr, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    if (id != 0){
+        cl->n = hdr[0]; cl->size = hdr[1];
+        cl->data = (unsigned char*)malloc((size_t)cl->size + 1);
+        cl->off = (int*)malloc(sizeof(int) * (size_t)(cl->n + 1));
+        if (!cl->data || !cl->off) die("mem");
     }
-    return 1;
+    if (cl->n == 0) return;
+    MPI_Bcast(cl->data, cl->size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(cl->off, cl->n + 1, MPI_INT, 0, MPI_COMM_WORLD);
+}
+
+static void crib_list_free(CribList* cl){
+    free(cl->data); free(cl->off);
+    memset(cl, 0, sizeof(*cl));
+}
+
+static void ac_build(AcAuto* ac, const CribList* cl){
+    if (cl->n > AC_MAX_PAT) die("Aho-Corasick: demasiados cribs (max 64)");
+    int cap = cl->size + 1;
+    ac->go = (int32_t(*)[256])malloc(sizeof(*ac->go) * (size_t)cap);
+    ac->out = (uint64_t*)calloc((size_t)cap, sizeof(uint64_t));
+    int32_t* fail = (int32_t*)calloc((size_t)cap, sizeof(int32_t));
+    int32_t* queue = (int32_t*)malloc(sizeof(int32_t) * (size_t)cap);
+    if (!ac->go || !ac->out || !fail || !queue) die("mem");
+    memset(ac->go[0], -1, sizeof(ac->go[0]));
+    ac->nstates = 1;
+    ac->npat = cl->n;
+    // trie
+    for (int p=0;p<cl->n;p++){
+        int s = 0;
+        for (int i=cl->off[p]; i<cl->off[p+1]; i++){
+            unsigned char c = cl->data[i];
+            if (ac->go[s][c] < 0){
+                memset(ac->go[ac->nstates], -1, sizeof(ac->go[0]));
+                ac->go[s][c] = ac->nstates++;
+            }
+            s = ac->go[s][c];
+        }
+        ac->out[s] |= 1ULL << p;
+    }
+    // BFS: fallas y transiciones completas
+    int qh = 0, qt = 0;
+    for (int c=0;c<256;c++){
+        int t = ac->go[0][c];
+        if (t < 0) ac->go[0][c] = 0;
+        else { fail[t] = 0; queue[qt++] = t; }
+    }
+    while (qh < qt){
+        int s = queue[qh++];
+        ac->out[s] |= ac->out[fail[s]];
+        for (int c=0;c<256;c++){
+            int t = ac->go[s][c];
+            if (t < 0) ac->go[s][c] = ac->go[fail[s]][c];
+            else { fail[t] = ac->go[fail[s]][c]; queue[qt++] = t; }
+        }
+    }
+    free(fail); free(queue);
+}
+
+static void ac_free(AcAuto* ac){
+    free(ac->go); free(ac->out);
+    ac->go = NULL; ac->out = NULL;
+}
+
+// ================= Puntaje de texto plano =================
+// Bytes "de texto": ASCII imprimible (0x20..0x7E) y \t \n \r. Se cuentan 8 bytes
+// por vez en un uint64 (SWAR), sin tablas ni saltos por byte.
+#define SWAR_ONES 0x0101010101010101ULL
+#define SWAR_HIGH 0x8080808080808080ULL
+
+static inline uint64_t swar_eq(uint64_t x, unsigned char c){
+    uint64_t y = x ^ (SWAR_ONES * c);
+    return ~(((y & ~SWAR_HIGH) + ~SWAR_HIGH) | y) & SWAR_HIGH;  // 0x80 en los bytes == c
+}
+
+static inline int text_bytes8(const unsigned char b[8]){
+    uint64_t x; memcpy(&x, b, 8);
+    uint64_t lo7 = x & ~SWAR_HIGH;
+    uint64_t ge20 = (lo7 + SWAR_ONES * 0x60) & SWAR_HIGH;     // byte >= 0x20 (sin bit 7)
+    uint64_t ge7f = (lo7 + SWAR_ONES * 0x01) & SWAR_HIGH;     // byte >= 0x7F
+    uint64_t m = (ge20 & ~ge7f & ~x) | swar_eq(x, '\t') | swar_eq(x, '\n') | swar_eq(x, '\r');
+    return __builtin_popcountll(m);
+}
+
+static int text_bytes(const unsigned char* b, int n){
+    int c = 0, i = 0;
+    for (; i+8<=n; i+=8) c += text_bytes8(b + i);
+    for (; i<n; i++) c += (b[i]>=0x20 && b[i]<=0x7E) || b[i]=='\t' || b[i]=='\n' || b[i]=='\r';
+    return c;
+}
+
+// Entropía de Shannon (bits/byte) de b[0..n)
+static double shannon_entropy(const unsigned char* b, int n){
+    if (n <= 0) return 0.0;
+    int h[256] = {0};
+    for (int i=0;i<n;i++) h[b[i]]++;
+    double H = 0.0;
+    for (int i=0;i<256;i++) if (h[i]){ double p = (double)h[i] / n; H -= p * log2(p); }
+    return H;
+}
+
+// ================= Modo de cifrado: CBC / 3DES =================
+// Por defecto todo es DES-ECB (los caminos rápidos: bitslice, kpa, batch, tmto).
+// Con -cbc y/o -3des se usa un CipherCfg. En brute la clave que se busca es K1:
+// K2 (y K3 con -3des 3) se pasan con -k2/-k3; con -3des 2, K3 = K1.
+typedef struct {
+    int cbc;                    // 0: ECB
+    unsigned char iv[BLK];      // IV (de -iv o el primer bloque de la entrada)
+    int ede;                    // 0: DES, 2: 3DES con 2 claves, 3: 3DES con 3 claves
+    DES_key_schedule ks2, ks3;  // K2 / K3 fijas
+} CipherCfg;
+
+// Bloque de texto plano en ciph[i..i+8) con K1 = ks. En CBC alcanza con el bloque
+// i-1 del ciphertext (o el IV): no hace falta descifrar los anteriores.
+static inline void try_block(CipherCfg* cc, DES_key_schedule* ks, const unsigned char* ciph, int i, unsigned char out[BLK]){
+    DES_cblock in;
+    memcpy(&in, ciph + i, BLK);
+    if (cc && cc->ede) DES_ecb3_encrypt(&in, (DES_cblock*)out, ks, &cc->ks2, cc->ede == 3 ? &cc->ks3 : ks, DES_DECRYPT);
+    else               DES_ecb_encrypt(&in, (DES_cblock*)out, ks, DES_DECRYPT);
+    if (cc && cc->cbc){
+        const unsigned char* prev = i ? ciph + i - BLK : cc->iv;
+        for (int j=0;j<BLK;j++) out[j] ^= prev[j];
+    }
+}
+
+// ================= Predicados de tryKey =================
+// Sin -cribs/-text/-maxent/-top se usa el camino de un solo crib (ventana + memmem).
+// Si no, tryKey pasa por try_pred: Aho-Corasick con los cribs (si hay), texto
+// imprimible >= text_min y entropía <= ent_max; todos tienen que cumplirse. Con
+// -top además se calcula un puntaje para rankear los candidatos.
+typedef struct {
+    const unsigned char* crib;
+    int crib_len;                      // 0: sin crib ninguna clave vale
+    int scan;                          // el crib debe caber en los primeros 'scan' bytes (0 = todo)
+    unsigned char win[CRIB_MAX + BLK]; // cola (crib_len-1 bytes) del bloque previo + bloque actual
+    // predicados (try_pred)
+    int pred;                          // usar try_pred
+    const AcAuto* ac;                  // NULL: sin cribs
+    double text_min;                   // fracción mínima de bytes de texto (0 = no se mira)
+    double ent_max;                    // entropía máxima en bits/byte (0 = no se mira)
+    int rank;                          // -top: recorrer toda la ventana y puntuar
+    double score;                      // puntaje del último acierto
+    unsigned char* pt;                 // texto plano de la ventana (por hilo, solo si hace falta)
+    CipherCfg* cc;                     // NULL: DES-ECB
+    int at;                            // -at: offset fijo del crib (-1: cualquiera)
+} TryCtx;
+
+static void try_ctx_init(TryCtx* tc, const unsigned char* crib, int crib_len, int scan){
+    if (crib_len > CRIB_MAX) die("crib demasiado largo (max 512 bytes)");
+    memset(tc, 0, sizeof(*tc));
+    tc->crib = crib;
+    tc->crib_len = crib_len;
+    tc->scan = scan;
+    tc->at = -1;
+}
+
+// Bytes de texto plano que hay que mirar para un buffer de len bytes
+static int try_scan_len(const TryCtx* tc, int len){
+    return (tc->scan > 0 && tc->scan < len) ? tc->scan : len;
 }
 
 // ================= Wrappers encrypt/decrypt/tryKey =================
 static void decrypt_des(uint64_t key, unsigned char *buf, int len){
     tirpc_ecb_crypt(key, buf, len, 0);
 }
-static void encrypt_des(uint64_t key, unsigned char *buf, int len){
-    tirpc_ecb_crypt(key, buf, len, 1);
-}
-static int tryKey(uint64_t key, const unsigned char *ciph, int len,
-                  const char* crib_text,
-                  const unsigned char* crib_bytes, int crib_bytes_len){
-    unsigned char* tmp = (unsigned char*)malloc(len);
-    if (!tmp) return 0;
-    memcpy(tmp, ciph, len);
-    tirpc_ecb_crypt(key, tmp, len, 0);
-    int ok = contains_crib_any(tmp, len, crib_text, crib_bytes, crib_bytes_len);
-    free(tmp);
+static void tirpc_key_schedule(uint64_t key, DES_key_schedule* ks){
+    unsigned char k8[8];
+    tirpc_make_key(key, k8);
+    DES_set_key_unchecked((DES_cblock*)k8, ks);
+}
+
+// ================= Key schedule incremental =================
+// El key schedule (PC-1, rotaciones, PC-2 y el empaquetado de OpenSSL) solo mueve
+// bits de la clave: es lineal sobre GF(2) y la paridad no entra. Entonces
+//   ks(k+1) = ks(k) ^ ks(k ^ (k+1)),  con k ^ (k+1) = bits 0..ctz(k+1) en 1,
+// y recorrer un rango contiguo cuesta un XOR de 128 bytes por clave en vez de
+// tirpc_make_key + DES_set_key_unchecked. Mismo orden y mismas claves que antes.
+#define KS_WORDS (sizeof(DES_key_schedule) / sizeof(uint64_t))
+
+typedef union {
+    DES_key_schedule ks;
+    uint64_t w[KS_WORDS];
+} KsBits;
+
+static KsBits KS_RUN[56];     // KS_RUN[j] = ks de la clave TI-RPC con los bits 0..j en 1
+static pthread_once_t ks_once = PTHREAD_ONCE_INIT;
+
+static void ks_tables_init(void){
+    KsBits bit[56];
+    for (int t=0;t<56;t++) tirpc_key_schedule(1ULL << t, &bit[t].ks);
+    for (int j=0;j<56;j++)
+        for (size_t w=0; w<KS_WORDS; w++)
+            KS_RUN[j].w[w] = bit[j].w[w] ^ (j ? KS_RUN[j-1].w[w] : 0);
+    // la linealidad depende del formato interno de OpenSSL: se verifica una vez
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (int r=0;r<64;r++){
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        uint64_t k = x & KEY56_MASK;
+        KsBits a, b;
+        tirpc_key_schedule(k, &a.ks);
+        memset(&b, 0, sizeof(b));
+        for (int t=0;t<56;t++)
+            if ((k >> t) & 1)
+                for (size_t w=0; w<KS_WORDS; w++) b.w[w] ^= bit[t].w[w];
+        if (memcmp(&a, &b, sizeof(a))) die("key schedule incremental: OpenSSL no es lineal en este build");
+    }
+}
+
+typedef struct {
+    KsBits s;
+    uint64_t k;
+} KeyWalk;
+
+static void kw_start(KeyWalk* w, uint64_t k){
+    pthread_once(&ks_once, ks_tables_init);
+    tirpc_key_schedule(k, &w->s.ks);
+    w->k = k;
+}
+
+// k -> k+1 (k+1 < 2^56)
+static inline void kw_next(KeyWalk* w){
+    const KsBits* d = &KS_RUN[__builtin_ctzll(++w->k)];
+    for (size_t i=0; i<KS_WORDS; i++) w->s.w[i] ^= d->w[i];
+}
+
+// Crib en un offset conocido (-at): solo los bloques que lo cubren, uno por vez;
+// casi todas las claves se descartan con el primero.
+static int try_crib_at(DES_key_schedule* ks, const unsigned char *ciph, int len, TryCtx* tc){
+    const int at = tc->at, clen = tc->crib_len;
+    if (at + clen > len) return 0;
+    unsigned char out[BLK];
+    for (int i = at / BLK * BLK, c = 0; c < clen; i += BLK){
+        try_block(tc->cc, ks, ciph, i, out);
+        int o = (i < at) ? at - i : 0;
+        int take = (BLK - o < clen - c) ? BLK - o : clen - c;
+        if (memcmp(out + o, tc->crib + c, (size_t)take)) return 0;
+        c += take;
+    }
+    return 1;
+}
+
+// Un solo crib: ventana deslizante + memmem, acepta en cuanto aparece
+static int try_crib(DES_key_schedule* ks, const unsigned char *ciph, int len, TryCtx* tc){
+    const int clen = tc->crib_len;
+    if (tc->at >= 0) return try_crib_at(ks, ciph, len, tc);
+    int last = try_scan_len(tc, len);
+    if (clen > last) return 0;
+
+    int keep = 0;
+    for (int i=0; i<last; i+=BLK){
+        unsigned char out[BLK];
+        try_block(tc->cc, ks, ciph, i, out);
+        int take = (last - i < BLK) ? (last - i) : BLK;
+        memcpy(tc->win + keep, out, (size_t)take);
+        keep += take;
+        if (memmem_naive(tc->win, keep, tc->crib, clen)) return 1;
+        if (keep > clen-1){
+            memmove(tc->win, tc->win + keep - (clen-1), (size_t)(clen-1));
+            keep = clen-1;
+        }
+    }
+    return 0;
+}
+
+// Puntaje (-top): cribs distintos encontrados + fracción de texto + (8 - entropía)/8
+static int try_pred(DES_key_schedule* ks, const unsigned char *ciph, int len, TryCtx* tc){
+    const int last = try_scan_len(tc, len);
+    const AcAuto* ac = tc->ac;
+    const int need_all = tc->rank || tc->text_min > 0 || tc->ent_max > 0;
+    const int budget = (tc->text_min > 0) ? (int)((1.0 - tc->text_min) * last) : last;
+    int st = 0, bad = 0;
+    uint64_t seen = 0;
+
+    for (int i=0; i<last; i+=BLK){
+        unsigned char out[BLK];
+        try_block(tc->cc, ks, ciph, i, out);
+        int take = (last - i < BLK) ? (last - i) : BLK;
+        if (tc->text_min > 0 || tc->rank){
+            bad += take - ((take == BLK) ? text_bytes8(out) : text_bytes(out, take));
+            if (tc->text_min > 0 && bad > budget) return 0;
+        }
+        if (ac){
+            for (int j=0;j<take;j++){
+                st = ac->go[st][out[j]];
+                seen |= ac->out[st];
+            }
+            if (seen && !need_all) return 1;
+        }
+        if (tc->pt) memcpy(tc->pt + i, out, (size_t)take);
+    }
+    if (ac && !seen) return 0;
+    double H = 0.0;
+    if (tc->pt) H = shannon_entropy(tc->pt, last);
+    if (tc->ent_max > 0 && H > tc->ent_max) return 0;
+    tc->score = __builtin_popcountll(seen) + (double)(last - bad) / last + (8.0 - H) / 8.0;
+    return 1;
+}
+
+// Cifra/descifra in[0..len) a out por tandas de STREAM_CHUNK (hex o binario), leyendo
+// directo del mmap y soltando las páginas ya procesadas: la memoria no depende del
+// largo. cc NULL: DES-ECB; en CBC el IV se encadena entre tandas. Devuelve el último
+// byte escrito.
+static int des_stream(uint64_t key, const CipherCfg* cc, const Input* in, size_t len, int do_encrypt, FILE* out, int as_hex){
+    const unsigned char* src = in->p;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const int enc = do_encrypt ? DES_ENCRYPT : DES_DECRYPT;
+    size_t dropped = 0;
+    DES_key_schedule ks, ks2, ks3;
+    tirpc_key_schedule(key, &ks);
+    const int ede = cc ? cc->ede : 0;
+    if (ede){ ks2 = cc->ks2; ks3 = (ede == 3) ? cc->ks3 : ks; }
+    DES_cblock iv;
+    if (cc) memcpy(iv, cc->iv, BLK);
+    static unsigned char chunk[STREAM_CHUNK];
+    int last = -1;
+    for (size_t off=0; off<len; off+=STREAM_CHUNK){
+        size_t m = (len - off < STREAM_CHUNK) ? len - off : STREAM_CHUNK;
+        if (cc && cc->cbc){
+            if (ede) DES_ede3_cbc_encrypt(src + off, chunk, (long)m, &ks, &ks2, &ks3, &iv, enc);
+            else     DES_ncbc_encrypt(src + off, chunk, (long)m, &ks, &iv, enc);
+        } else {
+            for (size_t i=0;i<m;i+=BLK){
+                if (ede) DES_ecb3_encrypt((const_DES_cblock*)(src + off + i), (DES_cblock*)(chunk + i), &ks, &ks2, &ks3, enc);
+                else     DES_ecb_encrypt((const_DES_cblock*)(src + off + i), (DES_cblock*)(chunk + i), &ks, enc);
+            }
+        }
+        if (as_hex) write_hex(out, chunk, m); else fwrite(chunk, 1, m, out);
+        last = chunk[m-1];
+        if (in->map){
+            size_t upto = (off + m) / page * page;
+            if (upto > dropped){ madvise((char*)in->map + dropped, upto - dropped, MADV_DONTNEED); dropped = upto; }
+        }
+    }
+    return last;
+}
+
+// Prueba un key schedule ya armado (KeyWalk, o el modo batch para todas las entradas)
+static int tryKeySchedule(DES_key_schedule* ks, const unsigned char *ciph, int len, TryCtx* tc){
+    if (tc->pred) return try_pred(ks, ciph, len, tc);
+    if (tc->crib_len <= 0) return 0;
+    return try_crib(ks, ciph, len, tc);
+}
+
+static int tryKey(uint64_t key, const unsigned char *ciph, int len, TryCtx* tc){
+    if (!tc->pred && tc->crib_len <= 0) return 0;
+    DES_key_schedule ks;
+    tirpc_key_schedule(key, &ks);
+    return tryKeySchedule(&ks, ciph, len, tc);
+}
+
+// ================= Diccionario de bloques ECB (modo kpa) =================
+// En ECB cada bloque se cifra por separado: si el crib cubre un bloque alineado
+// completo P, la clave correcta cumple E_k(P) == algún bloque del ciphertext.
+// Por cada alineación posible del crib (offset mod 8) se toma su primer bloque
+// completo; cada clave cuesta un key schedule + un DES por alineación + un
+// sondeo O(1), sin importar el largo del ciphertext. Los aciertos se confirman
+// con tryKey (descifrado completo).
+//
+// Complementación (-comp): E_{~k}(p) = ~E_k(~p). Con el mismo key schedule de k
+// se cifra también ~P y se busca ~E_k(~P): eso prueba la clave complementaria.
+// En el keymap TI-RPC ~k es k ^ KEY56_MASK, así que solo cae dentro del rango con
+// -bits 56; ahí basta con recorrer la mitad [0, 2^55).
+typedef struct {
+    uint64_t* slots;     // hash abierto (sondeo lineal) de bloques; 0 = vacío
+    uint64_t mask;
+    int has_zero;        // algún bloque del ciphertext vale 0
+    int npt;             // alineaciones con bloque completo
+    int comp;            // probar también ~k
+    DES_cblock pt[BLK];
+    DES_cblock ptc[BLK]; // ~pt
+} KpaCtx;
+
+static uint64_t kpa_hash(uint64_t v){
+    v ^= v >> 33; v *= 0xFF51AFD7ED558CCDULL; v ^= v >> 33;
+    return v;
+}
+
+static int kpa_has(const KpaCtx* kc, uint64_t v){
+    if (v == 0) return kc->has_zero;
+    for (uint64_t h = kpa_hash(v) & kc->mask; kc->slots[h]; h = (h+1) & kc->mask)
+        if (kc->slots[h] == v) return 1;
+    return 0;
+}
+
+// Arma el diccionario con los bloques de ct[0..len) y los bloques conocidos del crib.
+// Devuelve cuántas de las 8 alineaciones quedan cubiertas (0 si el crib es < 8 bytes).
+static int kpa_ctx_init(KpaCtx* kc, const unsigned char* ct, int len,
+                        const unsigned char* crib, int clen, int comp){
+    memset(kc, 0, sizeof(*kc));
+    kc->comp = comp;
+    for (int o=0;o<BLK;o++){
+        int d = (BLK - o) % BLK; // primer byte del crib que cae al inicio de un bloque
+        if (d + BLK > clen) continue;
+        int dup = 0;
+        for (int i=0;i<kc->npt;i++) if (!memcmp(kc->pt[i], crib+d, BLK)) dup = 1;
+        if (dup) continue;
+        memcpy(kc->pt[kc->npt], crib+d, BLK);
+        for (int i=0;i<BLK;i++) kc->ptc[kc->npt][i] = (unsigned char)~crib[d+i];
+        kc->npt++;
+    }
+    int nb = len / BLK;
+    uint64_t cap = 16;
+    while (cap < 2ULL*(uint64_t)nb) cap <<= 1;
+    kc->slots = (uint64_t*)calloc(cap, sizeof(uint64_t));
+    if (!kc->slots) die("mem");
+    kc->mask = cap - 1;
+    for (int b=0;b<nb;b++){
+        uint64_t v; memcpy(&v, ct + BLK*b, BLK);
+        if (v == 0){ kc->has_zero = 1; continue; }
+        if (kpa_has(kc, v)) continue;
+        uint64_t h = kpa_hash(v) & kc->mask;
+        while (kc->slots[h]) h = (h+1) & kc->mask;
+        kc->slots[h] = v;
+    }
+    return kc->npt;
+}
+
+static void kpa_ctx_free(KpaCtx* kc){
+    free(kc->slots);
+    kc->slots = NULL;
+}
+
+// bit 0: acierto para la clave de ks; bit 1: acierto para su complemento (si kc->comp)
+static int kpa_try_ks(const KpaCtx* kc, DES_key_schedule* ks){
+    int r = 0;
+    for (int i=0;i<kc->npt;i++){
+        DES_cblock out;
+        uint64_t v;
+        DES_ecb_encrypt((DES_cblock*)&kc->pt[i], &out, ks, DES_ENCRYPT);
+        memcpy(&v, out, BLK);
+        if (kpa_has(kc, v)) r |= 1;
+        if (kc->comp){
+            DES_ecb_encrypt((DES_cblock*)&kc->ptc[i], &out, ks, DES_ENCRYPT);
+            memcpy(&v, out, BLK);
+            if (kpa_has(kc, ~v)) r |= 2;
+        }
+    }
+    return r;
+}
+
+
+// ================= Ranking de candidatos (-top N) =================
+typedef struct {
+    uint64_t key;
+    double score;
+} Cand;
+
+typedef struct {
+    Cand* c;     // ordenados por score descendente
+    int n, cap;
+} TopN;
+
+static void top_init(TopN* t, int cap){
+    t->c = (Cand*)calloc((size_t)(cap ? cap : 1), sizeof(Cand));
+    if (!t->c) die("mem");
+    t->n = 0; t->cap = cap;
+}
+
+static void top_add(TopN* t, uint64_t key, double score){
+    if (t->n == t->cap && score <= t->c[t->n-1].score) return;
+    int i = (t->n < t->cap) ? t->n++ : t->n - 1;
+    while (i > 0 && t->c[i-1].score < score){ t->c[i] = t->c[i-1]; i--; }
+    t->c[i].key = key; t->c[i].score = score;
+}
+
+static void top_free(TopN* t){
+    free(t->c);
+    t->c = NULL; t->n = 0;
+}
+
+// ================= Búsqueda sobre un rango de claves =================
+typedef struct {
+    const unsigned char* ct;  // ciphertext completo
+    int len;
+    TryCtx* tc;
+    const BsKernel* kern;     // kernel bitslice (NULL: escalar)
+    BsCtx* bs;
+    int bs_len;               // bytes que descifra el kernel
+    KpaCtx* kc;               // modo kpa (NULL si no)
+    struct Batch_* batch;     // modo batch (NULL si no)
+    BsInput* bin;             // batch + kernel: entradas y aciertos por entrada
+    uint64_t* bhit;
+    TopN* top;                // -top: se guardan los mejores en vez de parar
+} Search;
+
+// Acierto confirmado: con -top se anota y se sigue, si no se para
+static inline int search_hit(Search* S, uint64_t key, uint64_t* found){
+    if (S->top){ top_add(S->top, key, S->tc->score); return 0; }
+    *found = key;
+    return 1;
+}
+
+// Prueba las claves [lo, hi] (lo múltiplo de 64 si hay kernel bitslice).
+// Devuelve 1 y deja la clave en *found al primer acierto confirmado.
+static int search_range(Search* S, uint64_t lo, uint64_t hi, uint64_t* found){
+    if (S->kern){
+        if (lo % 64) die("search_range: rango no alineado a 64 para el kernel bitslice");
+        const uint64_t L = (uint64_t)S->kern->lanes;
+        for (uint64_t base=lo; base<=hi; base+=L){
+            uint64_t cnt = (hi - base + 1 < L) ? (hi - base + 1) : L;
+            uint64_t hit[BS_MAX_WORDS];
+            if (!S->kern->try_keys(S->bs, base, S->ct, S->bs_len, hit)) continue;
+            for (uint64_t l=0; l<cnt; l++){
+                if (((hit[l>>6] >> (l&63)) & 1) && tryKey(base+l, S->ct, S->len, S->tc)
+                    && search_hit(S, base+l, found)) return 1;
+            }
+        }
+        return 0;
+    }
+    // escalar: key schedule incremental a lo largo del rango
+    KeyWalk kw;
+    kw_start(&kw, lo);
+    for (;;){
+        const uint64_t k = kw.k;
+        if (S->kc){
+            int h = kpa_try_ks(S->kc, &kw.s.ks);
+            if ((h & 1) && tryKeySchedule(&kw.s.ks, S->ct, S->len, S->tc) && search_hit(S, k, found)) return 1;
+            if ((h & 2) && tryKey(k ^ KEY56_MASK, S->ct, S->len, S->tc) && search_hit(S, k ^ KEY56_MASK, found)) return 1;
+        } else if (tryKeySchedule(&kw.s.ks, S->ct, S->len, S->tc) && search_hit(S, k, found)){
+            return 1;
+        }
+        if (k == hi) break;
+        kw_next(&kw);
+    }
+    return 0;
+}
+
+// ================= Modo batch: varios ciphertexts, un key schedule por clave =================
+// Manifiesto de texto, una entrada por línea (campos separados por TAB):
+//   in:PATH | hex:HEX | bytes:{..}   [TAB crib:TEXTO | TAB cribhex:HEX]
+// Sin crib se usa el de -crib/-cribhex. Líneas vacías o que empiezan con '#' se ignoran.
+// Cada clave se expande una vez (DES_set_key o la carga bitslice) y se prueba contra
+// todas las entradas pendientes; las resueltas salen del lote.
+typedef struct {
+    char name[64];              // fuente tal como aparece en el manifiesto (recortada)
+    unsigned char* ct;
+    int len;
+    int bs_len;                 // bytes que descifra el kernel
+    unsigned char crib[CRIB_MAX];
+    int crib_len;
+    _Atomic uint64_t found;     // 0 = pendiente, clave+1 = resuelta
+    int published;              // ya anotada en la ventana RMA (bajo mpi_lock)
+} BatchItem;
+
+typedef struct Batch_ {
+    BatchItem* it;
+    int n;
+    atomic_int left;            // entradas sin resolver
+} Batch;
+
+// Marca la entrada i como resuelta con key; devuelve 1 si la resolvió esta llamada
+static int batch_solve(Batch* B, int i, uint64_t key){
+    uint64_t expect = 0;
+    if (!atomic_compare_exchange_strong(&B->it[i].found, &expect, key + 1)) return 0;
+    atomic_fetch_sub(&B->left, 1);
+    return 1;
+}
+
+static char* trim_eol(char* s){
+    size_t L = strlen(s);
+    while (L && (s[L-1]=='\n' || s[L-1]=='\r')) s[--L] = 0;
+    return s;
+}
+
+// Lee el manifiesto (solo rank 0). Devuelve la cantidad de entradas.
+static int batch_load(const char* path, Batch* B, const unsigned char* def_crib, int def_clen){
+    FILE* f = fopen(path, "r");
+    if (!f) die("No pude leer -manifest");
+    char* line = NULL;
+    size_t lcap = 0;
+    int cap = 0, ln = 0;
+    B->it = NULL; B->n = 0;
+    while (getline(&line, &lcap, f) >= 0){
+        ln++;
+        trim_eol(line);
+        if (!line[0] || line[0]=='#') continue;
+        char* src = line;
+        char* cr = strchr(line, '\t');
+        if (cr) *cr++ = 0;
+        if (B->n == cap){
+            cap = cap ? 2*cap : 16;
+            B->it = (BatchItem*)realloc(B->it, sizeof(BatchItem) * (size_t)cap);
+            if (!B->it) die("mem");
+        }
+        BatchItem* it = &B->it[B->n];
+        memset(it, 0, sizeof(*it));
+        Input in;
+        int r = -1;
+        if (!strncmp(src, "in:", 3))         r = input_file(&in, src+3);
+        else if (!strncmp(src, "hex:", 4))   r = input_text(&in, src+4, 1);
+        else if (!strncmp(src, "bytes:", 6)) r = input_text(&in, src+6, 0);
+        int n = (r < 0 || in.n > (size_t)INT32_MAX) ? -1 : (int)in.n;
+        if (n > 0 && n % BLK == 0){
+            it->ct = (unsigned char*)malloc((size_t)n);   // se descifra en el lugar al final
+            if (!it->ct) die("mem");
+            memcpy(it->ct, in.p, (size_t)n);
+        }
+        if (r == 0) input_close(&in);
+        if (n <= 0 || n % BLK){
+            fprintf(stderr, "manifiesto línea %d: entrada inválida o no múltiplo de 8\n", ln);
+            die("manifiesto inválido");
+        }
+        it->len = n;
+        snprintf(it->name, sizeof(it->name), "%s", src);
+        if (cr && !strncmp(cr, "crib:", 5)){
+            it->crib_len = (int)strlen(cr+5);
+            if (it->crib_len > CRIB_MAX) die("crib demasiado largo (max 512 bytes)");
+            memcpy(it->crib, cr+5, (size_t)it->crib_len);
+        } else if (cr && !strncmp(cr, "cribhex:", 8)){
+            it->crib_len = from_hex(cr+8, it->crib, CRIB_MAX);
+            if (it->crib_len < 0){
+                fprintf(stderr, "manifiesto línea %d: cribhex inválido\n", ln);
+                die("manifiesto inválido");
+            }
+        } else {
+            if (cr && *cr) fprintf(stderr, "manifiesto línea %d: se ignora '%s'\n", ln, cr);
+            memcpy(it->crib, def_crib, (size_t)def_clen);
+            it->crib_len = def_clen;
+        }
+        if (it->crib_len == 0){
+            fprintf(stderr, "manifiesto línea %d: crib vacío\n", ln);
+            die("manifiesto inválido");
+        }
+        B->n++;
+    }
+    free(line);
+    fclose(f);
+    return B->n;
+}
+
+// Reparte el lote de rank 0 al resto (los nombres solo se usan al imprimir en rank 0)
+static void batch_bcast(Batch* B, int id){
+    MPI_Bcast(&B->n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (id != 0){
+        B->it = (BatchItem*)calloc((size_t)(B->n ? B->n : 1), sizeof(BatchItem));
+        if (!B->it) die("mem");
+    }
+    for (int i=0;i<B->n;i++){
+        BatchItem* it = &B->it[i];
+        int hdr[2] = { it->len, it->crib_len };
+        MPI_Bcast(hdr, 2, MPI_INT, 0, MPI_COMM_WORLD);
+        if (id != 0){
+            it->len = hdr[0]; it->crib_len = hdr[1];
+            it->ct = (unsigned char*)malloc((size_t)it->len);
+            if (!it->ct) die("mem");
+        }
+        MPI_Bcast(it->ct, it->len, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+        MPI_Bcast(it->crib, it->crib_len, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    }
+    atomic_init(&B->left, B->n);
+}
+
+static void batch_free(Batch* B){
+    for (int i=0;i<B->n;i++) free(B->it[i].ct);
+    free(B->it);
+    B->it = NULL; B->n = 0;
+}
+
+// Lote sobre [lo, hi]: devuelve cuántas entradas resolvió esta llamada
+static int search_batch(Search* S, uint64_t lo, uint64_t hi){
+    Batch* B = S->batch;
+    TryCtx* tc = S->tc;
+    int nsolved = 0;
+    if (S->kern){
+        if (lo % 64) die("search_batch: rango no alineado a 64 para el kernel bitslice");
+        const uint64_t L = (uint64_t)S->kern->lanes;
+        for (uint64_t base=lo; base<=hi && atomic_load(&B->left) > 0; base+=L){
+            uint64_t cnt = (hi - base + 1 < L) ? (hi - base + 1) : L;
+            for (int i=0;i<B->n;i++) S->bin[i].active = atomic_load(&B->it[i].found) == 0;
+            if (!S->kern->try_batch(S->bs, base, S->bin, B->n, S->bhit)) continue;
+            for (int i=0;i<B->n;i++){
+                const uint64_t* hit = S->bhit + (size_t)i*BS_MAX_WORDS;
+                if (!S->bin[i].active) continue;
+                tc->crib = B->it[i].crib; tc->crib_len = B->it[i].crib_len;
+                for (uint64_t l=0; l<cnt; l++){
+                    if (((hit[l>>6] >> (l&63)) & 1) && tryKey(base+l, B->it[i].ct, B->it[i].len, tc)){
+                        nsolved += batch_solve(B, i, base+l);
+                        break;
+                    }
+                }
+            }
+        }
+        return nsolved;
+    }
+    KeyWalk kw;
+    kw_start(&kw, lo);
+    while (atomic_load(&B->left) > 0){
+        const uint64_t k = kw.k;
+        for (int i=0;i<B->n;i++){
+            if (atomic_load(&B->it[i].found)) continue;
+            tc->crib = B->it[i].crib; tc->crib_len = B->it[i].crib_len;
+            if (tryKeySchedule(&kw.s.ks, B->it[i].ct, B->it[i].len, tc)) nsolved += batch_solve(B, i, k);
+        }
+        if (k == hi) break;
+        kw_next(&kw);
+    }
+    return nsolved;
+}
+
+// ================= Listas de rangos de claves =================
+typedef struct { uint64_t lo, hi; } KeyRange;   // [lo, hi] inclusive
+
+typedef struct {
+    KeyRange* r;
+    int n, cap;
+} RangeList;
+
+static void rl_add(RangeList* l, uint64_t lo, uint64_t hi){
+    if (l->n == l->cap){
+        l->cap = l->cap ? 2*l->cap : 16;
+        l->r = (KeyRange*)realloc(l->r, sizeof(KeyRange) * (size_t)l->cap);
+        if (!l->r) die("mem");
+    }
+    l->r[l->n].lo = lo; l->r[l->n].hi = hi; l->n++;
+}
+
+static int rl_cmp(const void* a, const void* b){
+    const KeyRange *x = (const KeyRange*)a, *y = (const KeyRange*)b;
+    return (x->lo > y->lo) - (x->lo < y->lo);
+}
+
+// Ordena y fusiona rangos solapados o contiguos
+static void rl_normalize(RangeList* l){
+    if (l->n < 2) return;
+    qsort(l->r, (size_t)l->n, sizeof(KeyRange), rl_cmp);
+    int m = 0;
+    for (int i=1;i<l->n;i++){
+        if (l->r[i].lo <= l->r[m].hi + 1 || l->r[m].hi == UINT64_MAX){
+            if (l->r[i].hi > l->r[m].hi) l->r[m].hi = l->r[i].hi;
+        } else {
+            l->r[++m] = l->r[i];
+        }
+    }
+    l->n = m + 1;
+}
+
+// out = [0, maxk] menos done (done normalizada)
+static void rl_complement(const RangeList* done, uint64_t maxk, RangeList* out){
+    uint64_t next = 0;
+    for (int i=0;i<done->n && next<=maxk;i++){
+        if (done->r[i].lo > next) rl_add(out, next, (done->r[i].lo - 1 < maxk) ? done->r[i].lo - 1 : maxk);
+        if (done->r[i].hi >= maxk) return;
+        if (done->r[i].hi + 1 > next) next = done->r[i].hi + 1;
+    }
+    if (next <= maxk) rl_add(out, next, maxk);
+}
+
+static void rl_free(RangeList* l){
+    free(l->r);
+    l->r = NULL; l->n = l->cap = 0;
+}
+
+// ================= Schedule: rangos pendientes partidos en bloques =================
+// Los bloques se numeran 0..nchunks-1 recorriendo los rangos en orden; cada rango
+// se redondea hacia afuera a múltiplos de 'align' (lanes del kernel) por los dos
+// extremos, sin pasar de 'top'; volver a probar unas claves no molesta.
+typedef struct {
+    uint64_t lo, hi;
+    uint64_t first;     // primer bloque del rango
+} SchedRange;
+
+typedef struct {
+    SchedRange* r;
+    int n;
+    uint64_t chunk, nchunks;
+} Sched;
+
+static void sched_build(Sched* s, const RangeList* todo, uint64_t chunk, uint64_t align, uint64_t top){
+    s->r = (SchedRange*)malloc(sizeof(SchedRange) * (size_t)(todo->n ? todo->n : 1));
+    if (!s->r) die("mem");
+    s->n = 0; s->chunk = chunk; s->nchunks = 0;
+    for (int i=0;i<todo->n;i++){
+        SchedRange* r = &s->r[s->n++];
+        r->lo = todo->r[i].lo / align * align;
+        r->hi = todo->r[i].hi / align * align + align - 1;
+        if (r->hi > top || r->hi < todo->r[i].hi) r->hi = top;
+        r->first = s->nchunks;
+        s->nchunks += (r->hi - r->lo) / chunk + 1;
+    }
+}
+
+static void sched_chunk(const Sched* s, uint64_t c, uint64_t* lo, uint64_t* hi){
+    int a = 0, b = s->n - 1;
+    while (a < b){
+        int m = (a + b + 1) / 2;
+        if (s->r[m].first <= c) a = m; else b = m - 1;
+    }
+    const SchedRange* r = &s->r[a];
+    *lo = r->lo + (c - r->first) * s->chunk;
+    *hi = (r->hi - *lo < s->chunk) ? r->hi : *lo + s->chunk - 1;
+}
+
+static void sched_free(Sched* s){
+    free(s->r);
+    s->r = NULL;
+}
+
+// ================= Reparto dinámico de bloques (RMA) =================
+// Rank 0 expone un contador de bloques y un flag de parada. Cada rank reclama
+// el siguiente bloque contiguo con MPI_Fetch_and_op y, en la misma época,
+// lee el flag: no hay colectivas dentro del bucle y un nodo lento no frena al resto.
+//
+// Con checkpoint, además hay un anillo de DONE_RING slots: al terminar el bloque
+// c se escribe c+1 en el slot c % DONE_RING (solo MPI_REPLACE, sin borrar nunca:
+// un valor viejo no coincide con c+1). Rank 0 avanza la marca de agua WATER
+// (todos los bloques < WATER terminados) y la publica; un bloque que todavía no
+// entra en el anillo queda pendiente y se reintenta en el próximo claim.
+//
+// En modo batch hay un slot por entrada (clave+1 si ya se resolvió, 0 si no) antes del anillo.
+enum { SLOT_NEXT = 0, SLOT_STOP = 1, SLOT_WATER = 2, SLOT_ITEMS = 3 };
+#define DONE_RING (1u<<20)
+#define MAX_PENDING 4096
+
+typedef struct {
+    MPI_Win win;
+    uint64_t* mem;
+    int track;              // registrar bloques terminados (checkpoint activo)
+    int nitems;             // entradas del modo batch
+    MPI_Aint ring;          // primer slot del anillo
+    uint64_t water_seen;    // WATER leída en el último claim
+    uint64_t pending[MAX_PENDING];
+    int npending;
+} WorkQueue;
+
+static void wq_init(WorkQueue* q, MPI_Comm comm, int id, int track, int nitems){
+    int nslots = SLOT_ITEMS + nitems + (track ? (int)DONE_RING : 0);
+    MPI_Aint sz = (id==0) ? (MPI_Aint)nslots * (MPI_Aint)sizeof(uint64_t) : 0;
+    memset(q, 0, sizeof(*q));
+    q->track = track;
+    q->nitems = nitems;
+    q->ring = SLOT_ITEMS + nitems;
+    MPI_Win_allocate(sz, sizeof(uint64_t), MPI_INFO_NULL, comm, &q->mem, &q->win);
+    if (id==0){
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, q->win);
+        for (int i=0;i<nslots;i++) q->mem[i] = 0;
+        MPI_Win_unlock(0, q->win);
+    }
+    MPI_Barrier(comm);
+    MPI_Win_lock_all(0, q->win);
+}
+
+// true si el bloque c ya se pudo anotar en el anillo
+static int wq_put_done(WorkQueue* q, uint64_t c){
+    if (c >= q->water_seen + DONE_RING) return 0;
+    uint64_t v = c + 1;
+    MPI_Accumulate(&v, 1, MPI_UINT64_T, 0, q->ring + (MPI_Aint)(c % DONE_RING),
+                   1, MPI_UINT64_T, MPI_REPLACE, q->win);
+    return 1;
+}
+
+// Anota el bloque c como terminado (no-op sin checkpoint)
+static void wq_mark_done(WorkQueue* q, uint64_t c){
+    if (!q->track) return;
+    if (wq_put_done(q, c)) MPI_Win_flush(0, q->win);
+    else if (q->npending < MAX_PENDING) q->pending[q->npending++] = c;
+    // si no entra, solo se pierde ese bloque en un -resume (se vuelve a probar)
+}
+
+// Reclama un bloque: 1 = ok, 0 = cola vacía, -1 = otro rank levantó la parada
+static int wq_claim(WorkQueue* q, uint64_t nchunks, uint64_t* chunk){
+    const uint64_t one = 1;
+    uint64_t stop = 0;
+    MPI_Fetch_and_op(&one, chunk, MPI_UINT64_T, 0, SLOT_NEXT, MPI_SUM, q->win);
+    MPI_Fetch_and_op(NULL, &stop, MPI_UINT64_T, 0, SLOT_STOP, MPI_NO_OP, q->win);
+    if (q->track) MPI_Fetch_and_op(NULL, &q->water_seen, MPI_UINT64_T, 0, SLOT_WATER, MPI_NO_OP, q->win);
+    MPI_Win_flush(0, q->win);
+    if (q->npending){
+        int m = 0;
+        for (int i=0;i<q->npending;i++)
+            if (!wq_put_done(q, q->pending[i])) q->pending[m++] = q->pending[i];
+        q->npending = m;
+        MPI_Win_flush(0, q->win);
+    }
+    if (stop) return -1;
+    return *chunk < nchunks;
+}
+
+// Publica las entradas resueltas acá (key1[i] != 0, clave+1) y trae el estado global
+static void wq_sync_items(WorkQueue* q, const uint64_t* key1, uint64_t* global){
+    for (int i=0;i<q->nitems;i++)
+        if (key1[i]) MPI_Accumulate(&key1[i], 1, MPI_UINT64_T, 0, SLOT_ITEMS + i, 1, MPI_UINT64_T, MPI_REPLACE, q->win);
+    MPI_Get_accumulate(NULL, 0, MPI_UINT64_T, global, q->nitems, MPI_UINT64_T,
+                       0, SLOT_ITEMS, q->nitems, MPI_UINT64_T, MPI_NO_OP, q->win);
+    MPI_Win_flush(0, q->win);
+}
+
+static void wq_signal_stop(WorkQueue* q){
+    const uint64_t one = 1;
+    MPI_Accumulate(&one, 1, MPI_UINT64_T, 0, SLOT_STOP, 1, MPI_UINT64_T, MPI_REPLACE, q->win);
+    MPI_Win_flush(0, q->win);
+}
+
+static void wq_free(WorkQueue* q){
+    MPI_Win_unlock_all(q->win);
+    MPI_Win_free(&q->win);
+}
+
+// ================= Checkpoint / -resume =================
+// Solo rank 0 escribe: rangos de claves ya cubiertos (corridas anteriores +
+// bloques < WATER + bloques terminados del anillo). Se escribe a PATH.tmp y se
+// renombra, así el archivo nunca queda a medias. Al reanudar se recorren solo
+// los rangos que faltan, con cualquier cantidad de ranks.
+typedef struct {
+    const char* path;
+    double every, last;
+    uint64_t fp, maxk;
+    RangeList prev;        // cubierto por corridas anteriores
+    const Sched* sched;
+    uint64_t water;
+    uint64_t* ring;        // copia local del anillo (DONE_RING)
+} Ckpt;
+
+// FNV-1a: identifica el trabajo (ciphertext, crib y parámetros)
+static uint64_t fnv1a(uint64_t h, const void* p, size_t n){
+    const unsigned char* b = (const unsigned char*)p;
+    for (size_t i=0;i<n;i++){ h ^= b[i]; h *= 0x100000001B3ULL; }
+    return h;
+}
+
+// Lee el checkpoint; devuelve 0 si no existe, -1 si es de otro trabajo
+static int ckpt_load(const char* path, uint64_t fp, uint64_t maxk, RangeList* done){
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[256];
+    int ok = 1;
+    unsigned long long a, b;
+    while (fgets(line, sizeof(line), f)){
+        if (sscanf(line, "fp %llx", &a) == 1){ if (a != fp) ok = -1; }
+        else if (sscanf(line, "maxk %llu", &a) == 1){ if (a != maxk) ok = -1; }
+        else if (sscanf(line, "done %llu %llu", &a, &b) == 2) rl_add(done, a, b);
+    }
+    fclose(f);
+    rl_normalize(done);
+    return ok;
+}
+
+static void ckpt_write(Ckpt* ck, WorkQueue* q){
+    // anillo completo con NO_OP (atómico por slot frente a los REPLACE remotos)
+    MPI_Get_accumulate(NULL, 0, MPI_UINT64_T, ck->ring, (int)DONE_RING, MPI_UINT64_T,
+                       0, q->ring, (int)DONE_RING, MPI_UINT64_T, MPI_NO_OP, q->win);
+    MPI_Win_flush(0, q->win);
+    const Sched* s = ck->sched;
+    uint64_t w = ck->water;
+    while (w < s->nchunks && ck->ring[w % DONE_RING] == w + 1) w++;
+    if (w != ck->water){
+        ck->water = w;
+        MPI_Accumulate(&w, 1, MPI_UINT64_T, 0, SLOT_WATER, 1, MPI_UINT64_T, MPI_REPLACE, q->win);
+        MPI_Win_flush(0, q->win);
+    }
+
+    RangeList cov = {0};
+    for (int i=0;i<ck->prev.n;i++) rl_add(&cov, ck->prev.r[i].lo, ck->prev.r[i].hi);
+    for (int i=0;i<s->n && s->r[i].first < w;i++){
+        uint64_t last = s->r[i].first + (s->r[i].hi - s->r[i].lo) / s->chunk;
+        uint64_t lo, hi;
+        sched_chunk(s, (w - 1 < last) ? w - 1 : last, &lo, &hi);
+        rl_add(&cov, s->r[i].lo, hi);
+    }
+    for (uint64_t c=w; c<s->nchunks && c<w+DONE_RING; c++){
+        if (ck->ring[c % DONE_RING] != c + 1) continue;
+        uint64_t lo, hi; sched_chunk(s, c, &lo, &hi);
+        rl_add(&cov, lo, hi);
+    }
+    rl_normalize(&cov);
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", ck->path);
+    FILE* f = fopen(tmp, "w");
+    if (f){
+        fprintf(f, "# bruteforce checkpoint v1\nfp %016llx\nmaxk %llu\n",
+                (unsigned long long)ck->fp, (unsigned long long)ck->maxk);
+        for (int i=0;i<cov.n;i++)
+            fprintf(f, "done %llu %llu\n", (unsigned long long)cov.r[i].lo, (unsigned long long)cov.r[i].hi);
+        fflush(f);
+        fsync(fileno(f));
+        fclose(f);
+        if (rename(tmp, ck->path) != 0) fprintf(stderr, "checkpoint: no pude renombrar %s\n", tmp);
+    } else {
+        fprintf(stderr, "checkpoint: no pude escribir %s\n", tmp);
+    }
+    rl_free(&cov);
+    ck->last = MPI_Wtime();
+}
+
+// ================= Hilos dentro de cada rank =================
+// Cada hilo tiene un rango pendiente propio (deque de rangos): toma GRAIN_KEYS
+// claves del frente y, si se queda sin trabajo, roba la mitad alta del rango de
+// otro hilo. Si no hay nada que robar, reclama un bloque nuevo a la cola RMA;
+// las llamadas MPI se serializan con mpi_lock (MPI_THREAD_SERIALIZED).
+#define GRAIN_KEYS 4096ULL
+
+typedef struct {
+    pthread_mutex_t m;
+    uint64_t lo, hi;   // pendiente: [lo, hi], vacío si !has
+    uint64_t c;        // bloque del schedule al que pertenece
+    int has;
+} RangeDeque;
+
+typedef struct {
+    WorkQueue* q;
+    const Sched* sched;
+    uint64_t grain, align;   // align = lanes del kernel (los cortes caen en múltiplos)
+    int nthreads;
+    RangeDeque* dq;
+    pthread_mutex_t mpi_lock;
+    int exhausted;           // cola RMA vacía (bajo mpi_lock)
+    int found;               // bajo mpi_lock
+    uint64_t key;
+    atomic_int stop;
+    const int* cpus;         // CPU de cada hilo (NULL: sin pinning)
+    // bloques en curso de este rank y claves que les faltan (bajo mpi_lock)
+    uint64_t* fl_c;
+    uint64_t* fl_left;
+    int nfl, capfl;
+    Ckpt* ck;                // solo rank 0 con checkpoint
+    Batch* B;                // modo batch
+    uint64_t* bpub;          // batch: buffers de wq_sync_items
+    uint64_t* bglob;
+} Engine;
+
+typedef struct {
+    Engine* E;
+    int tid;
+    Search S;
+    TryCtx tc;
+    BsCtx bs;
+    TopN top;
+} Worker;
+
+static int dq_pop(RangeDeque* d, uint64_t grain, uint64_t* lo, uint64_t* hi, uint64_t* c){
+    int ok = 0;
+    pthread_mutex_lock(&d->m);
+    if (d->has){
+        *lo = d->lo;
+        *hi = (d->hi - d->lo < grain) ? d->hi : d->lo + grain - 1;
+        *c = d->c;
+        if (*hi == d->hi) d->has = 0; else d->lo = *hi + 1;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->m);
     return ok;
 }
 
+static void dq_push(RangeDeque* d, uint64_t lo, uint64_t hi, uint64_t c){
+    pthread_mutex_lock(&d->m);
+    d->lo = lo; d->hi = hi; d->c = c; d->has = 1;
+    pthread_mutex_unlock(&d->m);
+}
+
+// Roba la mitad alta del primer rango ajeno con más de un grano pendiente. El corte
+// cae en un múltiplo absoluto de align (el kernel carga los bits bajos de la clave
+// de las lanes, así que cada rango tiene que empezar alineado); si redondeando no
+// le queda nada a la víctima, no se roba.
+static int engine_steal(Engine* E, int tid){
+    for (int i=1;i<E->nthreads;i++){
+        RangeDeque* v = &E->dq[(tid+i) % E->nthreads];
+        uint64_t lo=0, hi=0, c=0; int ok=0;
+        pthread_mutex_lock(&v->m);
+        if (v->has && v->hi - v->lo >= E->grain){
+            uint64_t half = (v->hi - v->lo + 1) / 2;
+            uint64_t cut = ((v->hi + 1 - half) + E->align - 1) / E->align * E->align;
+            if (cut > v->lo && cut <= v->hi){
+                lo = cut; hi = v->hi; c = v->c;
+                v->hi = lo - 1;
+                ok = 1;
+            }
+        }
+        pthread_mutex_unlock(&v->m);
+        if (ok){ dq_push(&E->dq[tid], lo, hi, c); return 1; }
+    }
+    return 0;
+}
+
+// Checkpoint periódico (rank 0, bajo mpi_lock)
+static void engine_ckpt_tick(Engine* E){
+    if (E->ck && MPI_Wtime() - E->ck->last >= E->ck->every) ckpt_write(E->ck, E->q);
+}
+
+// Batch (bajo mpi_lock): publica lo resuelto en este rank, adopta lo resuelto en
+// otros y, si ya no queda ninguna entrada, levanta la parada global
+static void engine_sync_batch(Engine* E){
+    Batch* B = E->B;
+    for (int i=0;i<B->n;i++){
+        uint64_t f = atomic_load(&B->it[i].found);
+        E->bpub[i] = (f && !B->it[i].published) ? f : 0;
+        if (f) B->it[i].published = 1;
+    }
+    wq_sync_items(E->q, E->bpub, E->bglob);
+    for (int i=0;i<B->n;i++)
+        if (E->bglob[i] && batch_solve(B, i, E->bglob[i] - 1)) B->it[i].published = 1;
+    if (atomic_load(&B->left) == 0 && !E->found){
+        E->found = 1;
+        wq_signal_stop(E->q);
+        atomic_store(&E->stop, 1);
+    }
+}
+
+static int engine_refill(Engine* E, int tid){
+    int ok = 0;
+    pthread_mutex_lock(&E->mpi_lock);
+    if (!E->exhausted && !atomic_load(&E->stop)){
+        uint64_t c;
+        int r = wq_claim(E->q, E->sched->nchunks, &c);
+        if (r > 0){
+            uint64_t lo, hi;
+            sched_chunk(E->sched, c, &lo, &hi);
+            if (E->nfl == E->capfl){
+                E->capfl = E->capfl ? 2*E->capfl : 16;
+                E->fl_c = (uint64_t*)realloc(E->fl_c, sizeof(uint64_t) * (size_t)E->capfl);
+                E->fl_left = (uint64_t*)realloc(E->fl_left, sizeof(uint64_t) * (size_t)E->capfl);
+                if (!E->fl_c || !E->fl_left) die("mem");
+            }
+            E->fl_c[E->nfl] = c; E->fl_left[E->nfl] = hi - lo + 1; E->nfl++;
+            dq_push(&E->dq[tid], lo, hi, c);
+            ok = 1;
+        } else {
+            E->exhausted = 1;
+            if (r < 0) atomic_store(&E->stop, 1);
+        }
+        if (E->B) engine_sync_batch(E);
+        engine_ckpt_tick(E);
+    }
+    pthread_mutex_unlock(&E->mpi_lock);
+    return ok;
+}
+
+// Se terminaron n claves del bloque c sin encontrar la clave
+static void engine_done(Engine* E, uint64_t c, uint64_t n){
+    if (!E->q->track) return;
+    pthread_mutex_lock(&E->mpi_lock);
+    for (int i=0;i<E->nfl;i++){
+        if (E->fl_c[i] != c) continue;
+        E->fl_left[i] -= n;
+        if (E->fl_left[i] == 0){
+            wq_mark_done(E->q, c);
+            E->fl_c[i] = E->fl_c[E->nfl-1]; E->fl_left[i] = E->fl_left[E->nfl-1]; E->nfl--;
+        }
+        break;
+    }
+    engine_ckpt_tick(E);
+    pthread_mutex_unlock(&E->mpi_lock);
+}
+
+static void engine_report(Engine* E, uint64_t key){
+    pthread_mutex_lock(&E->mpi_lock);
+    if (!E->found){
+        E->found = 1; E->key = key;
+        wq_signal_stop(E->q);
+    }
+    pthread_mutex_unlock(&E->mpi_lock);
+    atomic_store(&E->stop, 1);
+}
+
+static void* worker_main(void* arg){
+    Worker* w = (Worker*)arg;
+    Engine* E = w->E;
+    if (E->cpus){
+        cpu_set_t set; CPU_ZERO(&set); CPU_SET(E->cpus[w->tid], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    RangeDeque* mine = &E->dq[w->tid];
+    uint64_t lo, hi, c, k;
+    while (!atomic_load(&E->stop)){
+        if (!dq_pop(mine, E->grain, &lo, &hi, &c)){
+            if (!engine_steal(E, w->tid) && !engine_refill(E, w->tid)) break;
+            continue;
+        }
+        if (E->B){
+            if (search_batch(&w->S, lo, hi)){
+                pthread_mutex_lock(&E->mpi_lock);
+                engine_sync_batch(E);
+                pthread_mutex_unlock(&E->mpi_lock);
+            }
+        } else if (search_range(&w->S, lo, hi, &k)){ engine_report(E, k); break; }
+        engine_done(E, c, hi - lo + 1);
+    }
+    return NULL;
+}
+
+// Hilos a usar y CPU de cada uno. threads==0: todos los CPUs permitidos repartidos
+// entre los ranks del nodo. Con pin, si el rank tiene CPUs de sobra (--bind-to none)
+// se desplaza por su rank local para no pisar a los otros ranks del nodo.
+static int engine_plan_threads(int threads, int pin, int** cpus_out){
+    MPI_Comm node;
+    int lrank=0, lsize=1;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+    MPI_Comm_rank(node, &lrank);
+    MPI_Comm_size(node, &lsize);
+    MPI_Comm_free(&node);
+
+    cpu_set_t set; CPU_ZERO(&set);
+    int allowed[CPU_SETSIZE], na = 0;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0){
+        for (int c=0;c<CPU_SETSIZE;c++) if (CPU_ISSET(c, &set)) allowed[na++] = c;
+    }
+    if (na == 0){ allowed[0] = 0; na = 1; }
+    if (threads <= 0) threads = (na / lsize > 0) ? na / lsize : 1;
+
+    *cpus_out = NULL;
+    if (pin){
+        int* cpus = (int*)malloc(sizeof(int) * (size_t)threads);
+        if (!cpus) die("mem");
+        int off = (na >= lsize * threads) ? lrank * threads : 0;
+        for (int t=0;t<threads;t++) cpus[t] = allowed[(off + t) % na];
+        *cpus_out = cpus;
+    }
+    return threads;
+}
+
+// ================= TMTO: rainbow tables para un bloque de texto plano fijo =================
+// Con un bloque conocido P, f(k) = DES_k(P) y R_c(x) = (x ^ sal[c]) & maxk lleva el
+// ciphertext de vuelta a una clave de [0, maxk]. Una cadena es
+//   k_0 -> k_1 = R_0(f(k_0)) -> ... -> k_t
+// y de cada una solo se guarda (k_t, k_0). Con l tablas (sales distintas) de m cadenas
+// de largo t, recuperar k a partir de C = DES_k(P) cuesta ~l*t²/2 pasos en vez de 2^bits.
+// Archivo: TmtoHdr y después, por tabla, count[i] entradas ordenadas por 'end'
+// (endianness de la máquina que lo armó), para mmap + búsqueda binaria.
+#define TMTO_MAGIC "DESRT01"
+#define TMTO_MAX_TABLES 16
+
+typedef struct {
+    char magic[8];
+    uint32_t bits, chain_len, ntables, pad;
+    uint64_t chains;                    // cadenas calculadas por tabla
+    unsigned char pt[8];                // bloque de texto plano
+    uint64_t count[TMTO_MAX_TABLES];    // cadenas guardadas (puntos finales distintos)
+} TmtoHdr;
+
+typedef struct { uint64_t end, start; } TmtoEnt;
+
+typedef struct {
+    const TmtoHdr* h;
+    const TmtoEnt* ent[TMTO_MAX_TABLES];
+    void* map;
+    size_t len;
+} Tmto;
+
+static uint64_t splitmix64(uint64_t x){
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t tmto_f(uint64_t k, const unsigned char* pt){
+    DES_key_schedule ks;
+    DES_cblock out;
+    tirpc_key_schedule(k, &ks);
+    DES_ecb_encrypt((DES_cblock*)pt, &out, &ks, DES_ENCRYPT);
+    uint64_t v;
+    memcpy(&v, out, BLK);
+    return v;
+}
+
+// Una sal por columna; cada tabla usa su propia familia de reducciones
+static uint64_t* tmto_salts(int tbl, int t){
+    uint64_t* s = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)t);
+    if (!s) die("mem");
+    for (int c=0;c<t;c++) s[c] = splitmix64(((uint64_t)tbl << 32) | (uint64_t)c);
+    return s;
+}
+
+// Clave de la columna 'to' partiendo de k en la columna 'from'
+static uint64_t tmto_walk(uint64_t k, int from, int to, const uint64_t* salt, uint64_t maxk, const unsigned char* pt){
+    for (int c=from;c<to;c++) k = (tmto_f(k, pt) ^ salt[c]) & maxk;
+    return k;
+}
+
+// Probabilidad de que una clave al azar esté cubierta (modelo de Oechslin):
+// m_1 = m, m_{c+1} = N(1 - e^{-m_c/N}), P_tabla = 1 - prod(1 - m_c/N)
+static double tmto_coverage(double N, double m, int t, int l){
+    double lmiss = 0;
+    for (int c=0;c<t;c++){
+        lmiss += log1p(-m / N);
+        m = -N * expm1(-m / N);
+    }
+    return 1.0 - exp(lmiss * l);
+}
+
+static int tmto_cmp(const void* a, const void* b){
+    const TmtoEnt* x = (const TmtoEnt*)a, *y = (const TmtoEnt*)b;
+    if (x->end != y->end) return x->end < y->end ? -1 : 1;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+// Cada rank calcula un tramo de las cadenas de cada tabla; rank 0 las junta, ordena,
+// deja una por punto final y escribe PATH.tmp -> PATH.
+static void tmto_build(const char* path, const unsigned char* pt, int bits, int t, uint64_t m, int l, int id, int np){
+    const uint64_t maxk = (bits>=56) ? KEY56_MASK : ((1ULL<<bits)-1ULL);
+    const uint64_t base = m / (uint64_t)np, rem = m % (uint64_t)np;
+    const uint64_t lo = (uint64_t)id * base + ((uint64_t)id < rem ? (uint64_t)id : rem);
+    const int mine = (int)(base + ((uint64_t)id < rem));
+
+    MPI_Datatype ent_t;
+    MPI_Type_contiguous(2, MPI_UINT64_T, &ent_t);
+    MPI_Type_commit(&ent_t);
+    TmtoEnt* loc = (TmtoEnt*)malloc(sizeof(TmtoEnt) * (size_t)(mine ? mine : 1));
+    TmtoEnt* all = NULL;
+    int* cnt = NULL, *dsp = NULL;
+    FILE* f = NULL;
+    char tmp[4096];
+    TmtoHdr h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TMTO_MAGIC, sizeof(h.magic));
+    h.bits = (uint32_t)bits; h.chain_len = (uint32_t)t; h.ntables = (uint32_t)l; h.chains = m;
+    memcpy(h.pt, pt, BLK);
+    if (!loc) die("mem");
+    if (id==0){
+        all = (TmtoEnt*)malloc(sizeof(TmtoEnt) * (size_t)m);
+        cnt = (int*)malloc(sizeof(int) * (size_t)np);
+        dsp = (int*)malloc(sizeof(int) * (size_t)np);
+        if (!all || !cnt || !dsp) die("mem");
+        for (int r=0;r<np;r++){
+            cnt[r] = (int)(base + ((uint64_t)r < rem));
+            dsp[r] = r ? dsp[r-1] + cnt[r-1] : 0;
+        }
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        f = fopen(tmp, "wb");
+        if (!f || fwrite(&h, sizeof(h), 1, f) != 1) die("tmto: no pude escribir la tabla");
+    }
+
+    for (int tbl=0; tbl<l; tbl++){
+        double t0 = MPI_Wtime();
+        uint64_t* salt = tmto_salts(tbl, t);
+        // inicios distintos dentro de la tabla: j*impar + c es biyectiva módulo 2^bits
+        const uint64_t off = splitmix64(0x5EEDULL + (uint64_t)tbl);
+        for (int j=0;j<mine;j++){
+            uint64_t s = ((lo + (uint64_t)j) * 0x9E3779B97F4A7C15ULL + off) & maxk;
+            loc[j].start = s;
+            loc[j].end = tmto_walk(s, 0, t, salt, maxk, pt);
+        }
+        free(salt);
+        MPI_Gatherv(loc, mine, ent_t, all, cnt, dsp, ent_t, 0, MPI_COMM_WORLD);
+        if (id==0){
+            qsort(all, (size_t)m, sizeof(TmtoEnt), tmto_cmp);
+            uint64_t u = 0;
+            for (uint64_t i=0;i<m;i++)
+                if (u == 0 || all[i].end != all[u-1].end) all[u++] = all[i];
+            if (fwrite(all, sizeof(TmtoEnt), (size_t)u, f) != (size_t)u) die("tmto: no pude escribir la tabla");
+            h.count[tbl] = u;
+            fprintf(stderr, "tabla %d/%d: %llu cadenas, %llu puntos finales distintos (%.1f s)\n", tbl+1, l,
+                    (unsigned long long)m, (unsigned long long)u, MPI_Wtime() - t0);
+        }
+    }
+
+    if (id==0){
+        uint64_t tot = 0;
+        for (int i=0;i<l;i++) tot += h.count[i];
+        if (fseek(f, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, f) != 1) die("tmto: no pude escribir la tabla");
+        fflush(f);
+        fsync(fileno(f));
+        fclose(f);
+        if (rename(tmp, path) != 0) die("tmto: no pude renombrar la tabla");
+        fprintf(stderr, "tmto: %s, %.1f MiB, cobertura estimada %.1f%% de 2^%d\n", path,
+                (double)(sizeof(h) + tot * sizeof(TmtoEnt)) / (1 << 20),
+                100.0 * tmto_coverage((double)maxk + 1.0, (double)m, t, l), bits);
+        free(all); free(cnt); free(dsp);
+    }
+    free(loc);
+    MPI_Type_free(&ent_t);
+}
+
+static int tmto_open(Tmto* T, const char* path){
+    memset(T, 0, sizeof(*T));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TmtoHdr)){ close(fd); return -1; }
+    void* m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+    T->map = m; T->len = (size_t)st.st_size; T->h = (const TmtoHdr*)m;
+    const TmtoHdr* h = T->h;
+    size_t need = sizeof(TmtoHdr);
+    if (memcmp(h->magic, TMTO_MAGIC, sizeof(h->magic)) || h->ntables < 1 || h->ntables > TMTO_MAX_TABLES ||
+        h->bits < 1 || h->bits > 56 || h->chain_len < 1){
+        munmap(m, T->len); return -2;
+    }
+    for (uint32_t i=0;i<h->ntables;i++){
+        T->ent[i] = (const TmtoEnt*)((const unsigned char*)m + need);
+        need += (size_t)h->count[i] * sizeof(TmtoEnt);
+    }
+    if (need != T->len){ munmap(m, T->len); return -2; }
+    madvise(m, T->len, MADV_RANDOM);
+    return 0;
+}
+
+static void tmto_close(Tmto* T){
+    if (T->map) munmap(T->map, T->len);
+    memset(T, 0, sizeof(*T));
+}
+
+static const TmtoEnt* tmto_find(const TmtoEnt* e, uint64_t n, uint64_t end){
+    uint64_t a = 0, b = n;
+    while (a < b){
+        uint64_t mid = a + (b - a) / 2;
+        if (e[mid].end < end) a = mid + 1; else b = mid;
+    }
+    return (a < n && e[a].end == end) ? &e[a] : NULL;
+}
+
+// Busca k con DES_k(pt) == c. Cada rank revisa las columnas col ≡ id (mod np),
+// de la última (más barata) hacia la primera. 'falsas': puntos finales que coincidieron
+// pero cuya cadena no llegaba a c (merges de otras claves).
+static int tmto_lookup(const Tmto* T, uint64_t c, int id, int np, uint64_t* key, uint64_t* falsas){
+    const TmtoHdr* h = T->h;
+    const int t = (int)h->chain_len;
+    const uint64_t maxk = (h->bits>=56) ? KEY56_MASK : ((1ULL<<h->bits)-1ULL);
+    for (uint32_t tbl=0; tbl<h->ntables; tbl++){
+        uint64_t* salt = tmto_salts((int)tbl, t);
+        for (int col=t-1-id; col>=0; col-=np){
+            uint64_t x = tmto_walk((c ^ salt[col]) & maxk, col+1, t, salt, maxk, h->pt);
+            const TmtoEnt* e = tmto_find(T->ent[tbl], h->count[tbl], x);
+            if (!e) continue;
+            uint64_t k = tmto_walk(e->start, 0, col, salt, maxk, h->pt);
+            if (tmto_f(k, h->pt) == c){ *key = k; free(salt); return 1; }
+            (*falsas)++;
+        }
+        free(salt);
+    }
+    return 0;
+}
+
 // ================= main =================
+// bench.c incluye este archivo con BRUTEFORCE_NO_MAIN para medir las mismas funciones
+#ifndef BRUTEFORCE_NO_MAIN
 int main(int argc, char *argv[]){
-    MPI_Init(&argc, &argv);
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
     int N=1, id=0; MPI_Comm comm = MPI_COMM_WORLD;
     MPI_Comm_size(comm, &N);
     MPI_Comm_rank(comm, &id);
 
     const char* mode=NULL, *crib_text=" the ", *in_path=NULL, *hex_in=NULL, *bytes_in=NULL, *cribhex=NULL;
-    uint64_t key=0; int have_key=0; int bits=24; int trim=0;
+    const char* kernel_name="auto";
+    uint64_t key=0; int have_key=0; int bits=24; int trim=0; int scan=0; int comp=0;
+    uint64_t chunk=DEFAULT_CHUNK; int threads=1; int pin=1;
+    const char* ckpt_path=NULL; double ckpt_every=30.0; int resume=0;
+    const char* manifest=NULL;
+    const char* cribs_path=NULL; double text_min=0, ent_max=0; int top=0; int crib_set=0;
+    const char* table_path=NULL; int chain_len=1024, ntables=4, fallback=0; uint64_t nchains=0;
+    int cbc=0, ede=0, at=-1; const char* iv_hex=NULL;
+    uint64_t key2=0, key3=0; int have_key2=0, have_key3=0;
 
     for (int i=1;i<argc;i++){
         if (!strcmp(argv[i],"-mode") && i+1<argc) mode = argv[++i];
         else if (!strcmp(argv[i],"-k") && i+1<argc){ key = strtoull(argv[++i], NULL, 10); have_key=1; }
-        else if (!strcmp(argv[i],"-crib") && i+1<argc) crib_text = argv[++i];
-        else if (!strcmp(argv[i],"-cribhex") && i+1<argc) cribhex = argv[++i];
+        else if (!strcmp(argv[i],"-crib") && i+1<argc){ crib_text = argv[++i]; crib_set = 1; }
+        else if (!strcmp(argv[i],"-cribhex") && i+1<argc){ cribhex = argv[++i]; crib_set = 1; }
+        else if (!strcmp(argv[i],"-cribs") && i+1<argc) cribs_path = argv[++i];
+        else if (!strcmp(argv[i],"-text") && i+1<argc) text_min = atof(argv[++i]);
+        else if (!strcmp(argv[i],"-maxent") && i+1<argc) ent_max = atof(argv[++i]);
+        else if (!strcmp(argv[i],"-top") && i+1<argc) top = atoi(argv[++i]);
         else if (!strcmp(argv[i],"-bits") && i+1<argc) bits = atoi(argv[++i]);
         else if (!strcmp(argv[i],"-in") && i+1<argc) in_path = argv[++i];
         else if (!strcmp(argv[i],"-hex") && i+1<argc) hex_in = argv[++i];
         else if (!strcmp(argv[i],"-bytes") && i+1<argc) bytes_in = argv[++i];
         else if (!strcmp(argv[i],"-trim")) trim = 1;
+        else if (!strcmp(argv[i],"-kernel") && i+1<argc) kernel_name = argv[++i];
+        else if (!strcmp(argv[i],"-scan") && i+1<argc) scan = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-comp")) comp = 1;
+        else if (!strcmp(argv[i],"-chunk") && i+1<argc) chunk = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i],"-threads") && i+1<argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-pin") && i+1<argc) pin = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-ckpt") && i+1<argc) ckpt_path = argv[++i];
+        else if (!strcmp(argv[i],"-ckpt_every") && i+1<argc) ckpt_every = atof(argv[++i]);
+        else if (!strcmp(argv[i],"-resume")) resume = 1;
+        else if (!strcmp(argv[i],"-manifest") && i+1<argc) manifest = argv[++i];
+        else if (!strcmp(argv[i],"-table") && i+1<argc) table_path = argv[++i];
+        else if (!strcmp(argv[i],"-chain_len") && i+1<argc) chain_len = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-chains") && i+1<argc) nchains = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i],"-tables") && i+1<argc) ntables = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-fallback")) fallback = 1;
+        else if (!strcmp(argv[i],"-cbc")) cbc = 1;
+        else if (!strcmp(argv[i],"-iv") && i+1<argc) iv_hex = argv[++i];
+        else if (!strcmp(argv[i],"-3des") && i+1<argc) ede = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-k2") && i+1<argc){ key2 = strtoull(argv[++i], NULL, 10); have_key2=1; }
+        else if (!strcmp(argv[i],"-k3") && i+1<argc){ key3 = strtoull(argv[++i], NULL, 10); have_key3=1; }
+        else if (!strcmp(argv[i],"-at") && i+1<argc) at = atoi(argv[++i]);
     }
 
     if (!mode){
         if (id==0) fprintf(stderr,
             "Uso:\n"
-            "  mpirun -np P ./bruteforce -mode encrypt -k <clave> [-in | -hex HEX | -bytes \"{..}\"] [-trim]\n"
-            "  mpirun -np P ./bruteforce -mode decrypt -k <clave> [-in | -hex HEX | -bytes \"{..}\"] [-trim]\n"
-            "  mpirun -np P ./bruteforce -mode brute   [-in | -hex HEX | -bytes \"{..}\"] [-crib TXT|-cribhex HEX] [-bits 24] [-trim]\n"
-            "Notas: DES/ECB (keymap TI-RPC), sin padding. Longitud debe ser múltiplo de 8. Con -trim recorta al múltiplo inferior.\n");
+            "  mpirun -np P ./bruteforce -mode encrypt -k <clave> [-in | -hex HEX | -bytes \"{..}\"] [-trim] [-cbc [-iv HEX]] [-3des 2|3 -k2 K2 [-k3 K3]]\n"
+            "  mpirun -np P ./bruteforce -mode decrypt -k <clave> [-in | -hex HEX | -bytes \"{..}\"] [-trim] [-cbc [-iv HEX]] [-3des 2|3 -k2 K2 [-k3 K3]]\n"
+            "  mpirun -np P ./bruteforce -mode brute   [-in | -hex HEX | -bytes \"{..}\"] [-crib TXT|-cribhex HEX] [-at OFF] [-cbc [-iv HEX]] [-3des 2|3 -k2 K2 [-k3 K3]] [-cribs FILE] [-text MIN] [-maxent BITS] [-top N] [-scan BYTES] [-bits 24] [-chunk KEYS] [-threads N] [-pin 0|1] [-ckpt PATH [-ckpt_every SEG] [-resume]] [-trim] [-kernel auto|scalar|u64|sse2|avx2|avx512]\n"
+            "  mpirun -np P ./bruteforce -mode kpa     [-in | -hex HEX | -bytes \"{..}\"] [-crib TXT|-cribhex HEX] [-text MIN] [-maxent BITS] [-top N] [-scan BYTES] [-bits 24] [-chunk KEYS] [-threads N] [-pin 0|1] [-ckpt PATH [-ckpt_every SEG] [-resume]] [-comp] [-trim]\n"
+            "  mpirun -np P ./bruteforce -mode batch   -manifest FILE [-crib TXT|-cribhex HEX] [-scan BYTES] [-bits 24] [-chunk KEYS] [-threads N] [-pin 0|1] [-kernel ...]\n"
+            "  mpirun -np P ./bruteforce -mode tmto-build  -table FILE -crib TXT|-cribhex HEX [-bits 24] [-chain_len 1024] [-chains M] [-tables 4]\n"
+            "  mpirun -np P ./bruteforce -mode tmto-lookup -table FILE [-in | -hex HEX | -bytes \"{..}\"] [-fallback [opciones de brute]]\n"
+            "Notas: DES/ECB (keymap TI-RPC), sin padding. Longitud debe ser múltiplo de 8. Con -trim recorta al múltiplo inferior.\n"
+            "       -cbc sin -iv: el IV es el primer bloque de la entrada. Con -3des, brute busca K1.\n"
+            "       -threads N hilos por rank (0 = todos los CPUs del nodo); funciona también sin mpirun.\n"
+            "       -ckpt guarda los rangos de claves ya probados; con -resume se sigue desde ahí (cualquier -np).\n");
         MPI_Finalize(); return 1;
     }
 
-    // Cargar entrada
-    unsigned char *buf=(unsigned char*)malloc(MAXB);
-    if(!buf) die("mem");
-    int n=0;
-
-    if (hex_in){ n = from_hex(hex_in, buf, MAXB); if(n<0) die("HEX invalido"); }
-    else if (bytes_in){ n = from_bytes_list(bytes_in, buf, MAXB); if(n<0) die("Lista de bytes invalida"); }
-    else if (in_path){ n = read_file(in_path, buf, MAXB); if(n<0) die("No pude leer -in"); }
-    else {
-        // Por defecto: encrypt usa BEN10; decrypt/brute usa DEMO_CIPHER
-        if (!strcmp(mode,"encrypt")){
-            memcpy(buf, BEN10_PLAIN, sizeof(BEN10_PLAIN)-1); // -1 para no incluir '\0'
-            n = (int)(sizeof(BEN10_PLAIN)-1);
-        } else {
-            memcpy(buf, DEMO_CIPHER, sizeof(DEMO_CIPHER));
-            n = (int)sizeof(DEMO_CIPHER);
+    // Cargar entrada (solo rank 0; brute reparte después lo que haga falta)
+    Input in;
+    memset(&in, 0, sizeof(in));
+    size_t n_total = 0;
+    if (id==0){
+        if (hex_in){ if (input_text(&in, hex_in, 1) < 0) die("HEX invalido"); }
+        else if (bytes_in){ if (input_text(&in, bytes_in, 0) < 0) die("Lista de bytes invalida"); }
+        else if (in_path){ if (input_file(&in, in_path) < 0) die("No pude leer -in"); }
+        else {
+            // Por defecto: encrypt usa BEN10; decrypt/brute usa DEMO_CIPHER
+            if (!strcmp(mode,"encrypt")) input_static(&in, BEN10_PLAIN, sizeof(BEN10_PLAIN)-1); // -1 para no incluir '\0'
+            else                         input_static(&in, DEMO_CIPHER, sizeof(DEMO_CIPHER));
         }
+        n_total = in.n;
+        if (trim) n_total -= (n_total % 8);
+        if (n_total==0 || (n_total%8)!=0) die("Entrada no es múltiplo de 8 (usa -trim o recorta)");
     }
 
-    if (trim) n -= (n % 8);
-    if (n<=0 || (n%8)!=0) die("Entrada no es múltiplo de 8 (usa -trim o recorta)");
-
     // preparar crib por bytes si -cribhex
     unsigned char crib_b[512]; int crib_blen=0;
     if (cribhex && *cribhex){
         crib_blen = from_hex(cribhex, crib_b, (int)sizeof(crib_b));
         if (crib_blen<0) die("cribhex invalido");
     }
+    // un crib vacío aceptaría la primera clave probada: solo vale si hay otro predicado
+    const int crib_empty = crib_set && (cribhex ? crib_blen==0 : !*crib_text);
+    if (crib_empty && !cribs_path && text_min <= 0 && ent_max <= 0)
+        die("-crib/-cribhex vacio (usa -cribs, -text o -maxent para buscar sin crib)");
+
+    // CBC / 3DES (K2 y K3 son claves TI-RPC igual que -k)
+    CipherCfg cc;
+    memset(&cc, 0, sizeof(cc));
+    const int use_cc = cbc || ede;
+    const int iv_in = cbc && !iv_hex;   // IV = primer bloque de la entrada
+    cc.cbc = cbc;
+    cc.ede = ede;
+    if (ede){
+        if (ede != 2 && ede != 3) die("-3des debe ser 2 o 3");
+        if (!have_key2 || (ede == 3 && !have_key3)) die(ede == 3 ? "-3des 3 necesita -k2 y -k3" : "-3des 2 necesita -k2");
+        tirpc_key_schedule(key2, &cc.ks2);
+        if (ede == 3) tirpc_key_schedule(key3, &cc.ks3);
+    }
+    if (iv_hex){
+        if (!cbc) die("-iv solo tiene sentido con -cbc");
+        if (from_hex(iv_hex, cc.iv, BLK) != BLK) die("-iv debe ser de 8 bytes en hex");
+    }
+    if (use_cc && strcmp(mode,"encrypt") && strcmp(mode,"decrypt") && strcmp(mode,"brute"))
+        die("-cbc/-3des solo en -mode encrypt/decrypt/brute");
+    if (iv_in && strcmp(mode,"encrypt") && n_total < 2*BLK && id==0)
+        die("-cbc sin -iv: la entrada tiene que traer el IV y al menos un bloque");
+    Input body = in;                    // la entrada sin el bloque del IV
+    size_t body_n = n_total;
+    if (iv_in && id==0 && strcmp(mode,"encrypt")){
+        memcpy(cc.iv, in.p, BLK);
+        body.p += BLK; body.n -= BLK; body_n -= BLK;
+    }
 
+    // encrypt/decrypt: por tandas desde el mmap, la salida se va escribiendo
     if (!strcmp(mode,"encrypt")){
         if (!have_key) die("Falta -k");
-        encrypt_des(key, buf, n);
-        if (id==0) print_hex(buf, n);
-        free(buf); MPI_Finalize(); return 0;
+        if (id==0){
+            if (iv_in){
+                // IV nuevo al azar, sale como primer bloque del ciphertext
+                FILE* r = fopen("/dev/urandom", "rb");
+                if (!r || fread(cc.iv, 1, BLK, r) != BLK) die("No pude leer /dev/urandom para el IV");
+                fclose(r);
+                write_hex(stdout, cc.iv, BLK);
+            }
+            des_stream(key, use_cc ? &cc : NULL, &in, n_total, 1, stdout, 1);
+            printf("\n");
+        }
+        input_close(&in); MPI_Finalize(); return 0;
     }
 
     if (!strcmp(mode,"decrypt")){
         if (!have_key) die("Falta -k");
-        decrypt_des(key, buf, n);
-        if (id==0){ fwrite(buf,1,n,stdout); if (buf[n-1]!='\n') printf("\n"); }
-        free(buf); MPI_Finalize(); return 0;
+        if (id==0 && des_stream(key, use_cc ? &cc : NULL, &body, body_n, 0, stdout, 0) != '\n') printf("\n");
+        input_close(&in); MPI_Finalize(); return 0;
     }
 
-    if (!strcmp(mode,"brute")){
-        // Broadcast del buffer a todos los ranks
-        MPI_Bcast(&n,1,MPI_INT,0,MPI_COMM_WORLD);
-        MPI_Bcast(buf,n,MPI_UNSIGNED_CHAR,0,MPI_COMM_WORLD);
+    // tmto-build: el bloque de texto plano son los primeros 8 bytes del crib
+    if (!strcmp(mode,"tmto-build")){
+        if (!table_path) die("-mode tmto-build necesita -table FILE");
+        const unsigned char* pt = crib_blen>0 ? crib_b : (const unsigned char*)crib_text;
+        int pl = crib_blen>0 ? crib_blen : (int)strlen(crib_text);
+        if (!crib_set || pl < BLK) die("tmto necesita un bloque de texto plano: -crib/-cribhex de al menos 8 bytes");
+        if (bits < 1 || bits > 56) die("-bits fuera de rango (1..56)");
+        if (ntables < 1 || ntables > TMTO_MAX_TABLES) die("-tables fuera de rango (1..16)");
+        uint64_t nkeys = (bits>=56) ? KEY56_MASK : (1ULL<<bits);
+        if (chain_len < 1) die("-chain_len debe ser >= 1");
+        if ((uint64_t)chain_len > nkeys) chain_len = (int)nkeys;
+        if (nchains == 0) nchains = nkeys / (uint64_t)chain_len;   // m*t = 2^bits por tabla
+        if (nchains > nkeys) nchains = nkeys;
+        if (nchains > (uint64_t)INT32_MAX) die("-chains demasiado grande (max 2^31-1 por tabla)");
+        if (id==0){
+            if (pl > BLK) fprintf(stderr, "tmto: se usan los primeros 8 bytes del crib\n");
+            fprintf(stderr, "tmto: 2^%d claves, %d tablas x %llu cadenas x %d pasos\n", bits, ntables,
+                    (unsigned long long)nchains, chain_len);
+        }
+        tmto_build(table_path, pt, bits, chain_len, nchains, ntables, id, N);
+        input_close(&in); MPI_Finalize(); return 0;
+    }
 
-        uint64_t maxk = (bits>=56) ? ((1ULL<<56)-1ULL) : ((1ULL<<bits)-1ULL);
+    // tmto-lookup: el primer bloque del ciphertext es DES_k(pt) con pt el de la tabla.
+    // Si la clave no está cubierta y hay -fallback, sigue como brute con ese bloque de crib.
+    if (!strcmp(mode,"tmto-lookup")){
+        if (!table_path) die("-mode tmto-lookup necesita -table FILE");
+        Tmto T;
+        int r = tmto_open(&T, table_path);
+        if (r == -1) die("No pude leer -table");
+        if (r < 0) die("-table no es una tabla tmto valida");
+        uint64_t c = 0;
+        if (id==0) memcpy(&c, in.p, BLK);
+        MPI_Bcast(&c, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        uint64_t k = 0, falsas = 0, fg = 0;
+        int f = tmto_lookup(&T, c, id, N, &k, &falsas);
+        int ff = 0;
+        MPI_Allreduce(&f, &ff, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        if (!f) k = 0;
+        MPI_Allreduce(&k, &fg, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &falsas, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        if (id==0) fprintf(stderr, "tmto: %s en %.2f s (%llu falsas alarmas)\n", ff ? "encontrada" : "no está en la tabla",
+                           MPI_Wtime() - t0, (unsigned long long)falsas);
+        bits = (int)T.h->bits;
+        memcpy(crib_b, T.h->pt, BLK);
+        tmto_close(&T);
+        if (ff){
+            if (id==0){
+                printf("FOUND_KEY: %llu\n", (unsigned long long)fg);
+                des_stream(fg, NULL, &in, n_total, 0, stdout, 0);
+                printf("\n");
+            }
+            input_close(&in); MPI_Finalize(); return 0;
+        }
+        if (!fallback){
+            if (id==0) printf("No se encontro clave en la tabla (2^%d)\n", bits);
+            input_close(&in); MPI_Finalize(); return 0;
+        }
+        // brute sobre todo 2^bits, buscando el bloque de la tabla en el primer bloque
+        if (id==0) fprintf(stderr, "tmto: -fallback, se sigue con brute en 2^%d\n", bits);
+        mode = "brute";
+        crib_blen = BLK; crib_set = 1;
+        if (scan == 0) scan = BLK;
+    }
+
+    int kpa = !strcmp(mode,"kpa");
+    int batch = !strcmp(mode,"batch");
+    if (!strcmp(mode,"brute") || kpa || batch){
+        // Solo viaja el prefijo que mira el predicado (todo, o los bloques de -scan);
+        // rank 0 lo usa directo del mmap
+        if (at >= 0){
+            // -at: el crib va en [at, at+len); solo hacen falta esos bloques
+            if (kpa || batch) die("-at solo en -mode brute");
+            scan = at + (crib_blen > 0 ? crib_blen : (int)strlen(crib_text));
+        }
+        uint64_t nn[2] = { n_total, n_total };
+        const uint64_t ivb = iv_in ? BLK : 0;
+        if (scan > 0 && (uint64_t)scan + ivb < n_total) nn[1] = ((uint64_t)scan + BLK - 1) / BLK * BLK + ivb;
+        MPI_Bcast(nn, 2, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        if (nn[1] > (uint64_t)(INT32_MAX - BLK)) die("Entrada demasiado grande para buscar entera: usar -scan BYTES");
+        int n = (int)nn[1];
+        unsigned char* rbuf = NULL;
+        if (id!=0){
+            rbuf = (unsigned char*)malloc((size_t)n);
+            if (!rbuf) die("mem");
+        }
+        const unsigned char* buf = (id==0) ? in.p : rbuf;
+        MPI_Bcast((void*)buf,n,MPI_UNSIGNED_CHAR,0,MPI_COMM_WORLD);
+        // ct/ctn: el ciphertext que se prueba (sin el bloque del IV)
+        const unsigned char* ct = buf;
+        int ctn = n;
+        if (iv_in){ memcpy(cc.iv, buf, BLK); ct += BLK; ctn -= BLK; }
+        Batch B;
+        memset(&B, 0, sizeof(B));
+        if (batch){
+            if (!manifest) die("-mode batch necesita -manifest FILE");
+            if (id==0){
+                const unsigned char* dc = crib_blen>0 ? crib_b : (const unsigned char*)crib_text;
+                int dl = crib_blen>0 ? crib_blen : (int)strlen(crib_text);
+                if (dl > CRIB_MAX) die("crib demasiado largo (max 512 bytes)");
+                if (batch_load(manifest, &B, dc, dl) == 0) die("manifiesto vacío");
+                fprintf(stderr, "batch: %d entradas\n", B.n);
+            }
+            batch_bcast(&B, id);
+            if (ckpt_path){
+                if (id==0) fprintf(stderr, "-ckpt no está soportado en -mode batch, se ignora\n");
+                ckpt_path = NULL;
+            }
+        }
+        if (top > 0 && ckpt_path){
+            // el ranking de una corrida cortada no se guarda
+            if (id==0) fprintf(stderr, "-ckpt no está soportado con -top, se ignora\n");
+            ckpt_path = NULL;
+        }
+
+        uint64_t maxk = (bits>=56) ? KEY56_MASK : ((1ULL<<bits)-1ULL);
         uint64_t found_local=0, found_global=0;
         int f_local=0, f_global=0;
 
-        for (uint64_t k=id; k<=maxk; k+=(uint64_t)N){
-            if (tryKey(k, buf, n, (crib_blen>0?NULL:crib_text), (crib_blen>0?crib_b:NULL), crib_blen)){
-                found_local=k; f_local=1;
+        // crib como bytes: -cribhex tiene prioridad sobre -crib. El crib por defecto
+        // (" the ") solo se usa si no se pidió ningún otro predicado.
+        int use_pred = cribs_path || text_min > 0 || ent_max > 0 || top > 0;
+        if (use_pred && (batch || (kpa && cribs_path)))
+            die(batch ? "-mode batch no admite -cribs/-text/-maxent/-top" : "-mode kpa usa un solo crib (sin -cribs)");
+        if (use_pred && at >= 0) die("-at usa un solo crib (sin -cribs/-text/-maxent/-top)");
+        CribList cl;
+        memset(&cl, 0, sizeof(cl));
+        if (id==0){
+            if (crib_blen>0) crib_list_add(&cl, crib_b, crib_blen);
+            else if (!crib_empty && (crib_set || !use_pred)) crib_list_add(&cl, (const unsigned char*)crib_text, (int)strlen(crib_text));
+            if (cribs_path) crib_list_load(cribs_path, &cl);
+        }
+        crib_list_bcast(&cl, id);
+        TryCtx tc;
+        if (cl.n == 1) try_ctx_init(&tc, cl.data, cl.off[1], scan);
+        else           try_ctx_init(&tc, NULL, 0, scan);
+        tc.at = at;
+        if (use_cc) tc.cc = &cc;
+        AcAuto ac;
+        memset(&ac, 0, sizeof(ac));
+        if (use_pred){
+            if (cl.n > 0){ ac_build(&ac, &cl); tc.ac = &ac; }
+            tc.pred = 1;
+            tc.text_min = text_min;
+            tc.ent_max = ent_max;
+            tc.rank = top > 0;
+            if (id==0) fprintf(stderr, "predicados: %d cribs%s%s%s\n", cl.n,
+                               text_min > 0 ? ", texto" : "", ent_max > 0 ? ", entropia" : "",
+                               top > 0 ? ", ranking" : "");
+        }
+        // el kernel solo necesita los bloques que cubren la ventana de búsqueda
+        int scan_n = try_scan_len(&tc, ctn);
+        int bs_len = (scan_n + BLK - 1) / BLK * BLK;
+        int batch_cmax = 0;   // crib más largo del lote (tamaño del anillo bitslice)
+        for (int i=0;i<B.n;i++){
+            B.it[i].bs_len = (try_scan_len(&tc, B.it[i].len) + BLK - 1) / BLK * BLK;
+            if (B.it[i].crib_len > batch_cmax) batch_cmax = B.it[i].crib_len;
+        }
+
+        // Kernel bitslice: prefiltra 64..512 claves por pasada buscando el crib;
+        // las lanes candidatas se confirman con tryKey (mismo criterio que el camino escalar).
+        // Sin crib cualquier clave vale, así que no hace falta el kernel.
+        const BsKernel* kern = NULL;
+        KpaCtx kc;
+        // Complementación: ~k = k ^ KEY56_MASK solo está en rango si maxk cubre los 56 bits;
+        // entonces se recorre la mitad baja y cada clave prueba también su complemento.
+        int use_comp = 0;
+        uint64_t maxk_enum = maxk;
+        if (kpa && comp){
+            if (maxk == KEY56_MASK){ use_comp = 1; maxk_enum = maxk >> 1; }
+            else if (id==0) fprintf(stderr, "-comp: con -bits < 56 las claves complementarias quedan fuera de rango, se ignora\n");
+        }
+        if (kpa){
+            int nal = kpa_ctx_init(&kc, ct, bs_len, tc.crib, tc.crib_len, use_comp);
+            if (nal == 0) die("kpa necesita un crib de al menos 8 bytes");
+            // con crib < 15 bytes no todas las alineaciones tienen un bloque completo
+            if (id==0) fprintf(stderr, "kernel: kpa (%d bloques conocidos%s)\n", nal,
+                               tc.crib_len < 2*BLK-1 ? ", crib < 15 bytes: hay alineaciones sin probar" : "");
+        } else {
+            // el kernel bitslice es DES-ECB: CBC/3DES van por el camino escalar (try_block)
+            if ((batch ? batch_cmax : tc.crib_len)>0 && strcmp(kernel_name,"scalar") && !use_cc){
+                kern = bs_select(kernel_name);
+                if (!kern) die("Kernel no soportado (use auto|scalar|u64|sse2|avx2|avx512)");
+            }
+            if (id==0) fprintf(stderr, "kernel: %s%s\n", kern ? kern->name : "scalar",
+                               use_cc ? (ede ? (cbc ? " (3DES-CBC)" : " (3DES-ECB)") : " (CBC)") : "");
+        }
+
+        if (threads != 1 && provided < MPI_THREAD_SERIALIZED){
+            if (id==0) fprintf(stderr, "MPI sin soporte MPI_THREAD_SERIALIZED: se usa 1 hilo por rank\n");
+            threads = 1;
+        }
+        int* cpus = NULL;
+        threads = engine_plan_threads(threads, pin && threads != 1, &cpus);
+        if (id==0 && threads > 1) fprintf(stderr, "hilos por rank: %d%s\n", threads, cpus ? " (pinned)" : "");
+
+        // Bloques contiguos de 'chunk' claves (múltiplo de las lanes del kernel)
+        uint64_t L = kern ? (uint64_t)kern->lanes : 1;
+        if (chunk < L) chunk = L;
+        chunk = (chunk + L - 1) / L * L;
+
+        // Rangos pendientes: todo [0, maxk_enum] o, con -resume, lo que falta según el checkpoint
+        uint64_t fp = 0xCBF29CE484222325ULL;
+        fp = fnv1a(fp, &kpa, sizeof(kpa));
+        fp = fnv1a(fp, &use_comp, sizeof(use_comp));
+        fp = fnv1a(fp, &tc.scan, sizeof(tc.scan));
+        fp = fnv1a(fp, cl.data, (size_t)cl.size);
+        fp = fnv1a(fp, &text_min, sizeof(text_min));
+        fp = fnv1a(fp, &ent_max, sizeof(ent_max));
+        fp = fnv1a(fp, &at, sizeof(at));
+        if (use_cc){
+            fp = fnv1a(fp, &cc.cbc, sizeof(cc.cbc));
+            fp = fnv1a(fp, &cc.ede, sizeof(cc.ede));
+            fp = fnv1a(fp, cc.iv, BLK);
+            fp = fnv1a(fp, &key2, sizeof(key2));
+            fp = fnv1a(fp, &key3, sizeof(key3));
+        }
+        fp = fnv1a(fp, buf, (size_t)n);
+        Ckpt ck;
+        memset(&ck, 0, sizeof(ck));
+        RangeList todo = {0};
+        if (id==0){
+            if (ckpt_path && resume){
+                int r = ckpt_load(ckpt_path, fp, maxk_enum, &ck.prev);
+                if (r < 0) die("-resume: el checkpoint es de otra entrada/crib/-bits");
+                if (r == 0) fprintf(stderr, "-resume: no existe %s, se empieza de cero\n", ckpt_path);
+            } else if (resume){
+                fprintf(stderr, "-resume sin -ckpt: se ignora\n");
+            }
+            rl_complement(&ck.prev, maxk_enum, &todo);
+            if (ck.prev.n){
+                uint64_t left = 0;
+                for (int i=0;i<todo.n;i++) left += todo.r[i].hi - todo.r[i].lo + 1;
+                fprintf(stderr, "-resume: faltan %llu claves en %d rangos\n", (unsigned long long)left, todo.n);
+            }
+        }
+        MPI_Bcast(&todo.n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (id!=0){
+            todo.cap = todo.n;
+            todo.r = (KeyRange*)malloc(sizeof(KeyRange) * (size_t)(todo.n ? todo.n : 1));
+            if (!todo.r) die("mem");
+        }
+        MPI_Bcast(todo.r, 2*todo.n, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        Sched sched;
+        sched_build(&sched, &todo, chunk, L, maxk_enum);
+        rl_free(&todo);
+
+        WorkQueue q;
+        wq_init(&q, comm, id, ckpt_path != NULL, B.n);
+        if (id==0 && ckpt_path){
+            ck.path = ckpt_path; ck.every = ckpt_every; ck.last = MPI_Wtime();
+            ck.fp = fp; ck.maxk = maxk_enum; ck.sched = &sched;
+            ck.ring = (uint64_t*)malloc(sizeof(uint64_t) * DONE_RING);
+            if (!ck.ring) die("mem");
+        }
+        Engine E;
+        memset(&E, 0, sizeof(E));
+        E.q = &q; E.sched = &sched;
+        E.ck = (id==0 && ckpt_path) ? &ck : NULL;
+        if (batch){
+            E.B = &B;
+            E.bpub = (uint64_t*)calloc((size_t)B.n, sizeof(uint64_t));
+            E.bglob = (uint64_t*)calloc((size_t)B.n, sizeof(uint64_t));
+            if (!E.bpub || !E.bglob) die("mem");
+        }
+        E.align = L;
+        E.grain = (GRAIN_KEYS + L - 1) / L * L;
+        E.nthreads = threads;
+        E.cpus = cpus;
+        pthread_mutex_init(&E.mpi_lock, NULL);
+        atomic_init(&E.stop, 0);
+        E.dq = (RangeDeque*)calloc((size_t)threads, sizeof(RangeDeque));
+        Worker* W = (Worker*)calloc((size_t)threads, sizeof(Worker));
+        pthread_t* th = (pthread_t*)calloc((size_t)threads, sizeof(pthread_t));
+        if (!E.dq || !W || !th) die("mem");
+        for (int t=0;t<threads;t++){
+            pthread_mutex_init(&E.dq[t].m, NULL);
+            Worker* w = &W[t];
+            w->E = &E; w->tid = t;
+            w->tc = tc; // cada hilo con su propia ventana
+            if (batch){
+                // el anillo tiene que alcanzar al crib más largo del lote
+                if (kern && !bs_ctx_init(&w->bs, kern, B.it[0].crib, batch_cmax)) die("mem");
+            } else if (kern && !bs_ctx_init(&w->bs, kern, tc.crib, tc.crib_len)) die("mem");
+            if (tc.pred && (top > 0 || ent_max > 0)){
+                w->tc.pt = (unsigned char*)malloc((size_t)scan_n + BLK);
+                if (!w->tc.pt) die("mem");
             }
-            // parada cooperativa no saturante
-            if (f_local || (k % 4096 == (uint64_t)id)){
-                MPI_Allreduce(&f_local,&f_global,1,MPI_INT,MPI_MAX,MPI_COMM_WORLD);
-                if (f_global){
-                    MPI_Allreduce(&found_local,&found_global,1,MPI_UNSIGNED_LONG_LONG,MPI_MAX,MPI_COMM_WORLD);
-                    break;
+            Search S = { ct, ctn, &w->tc, kern, &w->bs, bs_len, kpa ? &kc : NULL, NULL, NULL, NULL, NULL };
+            if (top > 0){ top_init(&w->top, top); S.top = &w->top; }
+            if (batch){
+                S.batch = &B;
+                S.bin = (BsInput*)calloc((size_t)B.n, sizeof(BsInput));
+                S.bhit = (uint64_t*)calloc((size_t)B.n * BS_MAX_WORDS, sizeof(uint64_t));
+                if (!S.bin || !S.bhit) die("mem");
+                for (int i=0;i<B.n;i++){
+                    BsInput bi = { B.it[i].ct, B.it[i].bs_len, B.it[i].crib, B.it[i].crib_len, 1 };
+                    S.bin[i] = bi;
                 }
             }
+            w->S = S;
         }
+        // el hilo principal es el trabajador 0
+        for (int t=1;t<threads;t++)
+            if (pthread_create(&th[t], NULL, worker_main, &W[t])) die("pthread_create");
+        worker_main(&W[0]);
+        for (int t=1;t<threads;t++) pthread_join(th[t], NULL);
+        if (batch){
+            // lo que se resolvió en la última vuelta de cada rank llega a rank 0
+            engine_sync_batch(&E);
+            MPI_Barrier(MPI_COMM_WORLD);
+            for (int i=0;i<B.n;i++) E.bpub[i] = 0;
+            if (id==0) wq_sync_items(&q, E.bpub, E.bglob);
+        }
+        if (ckpt_path){
+            // todos los bloques terminados ya están en el anillo de rank 0
+            MPI_Win_flush_all(q.win);
+            MPI_Barrier(MPI_COMM_WORLD);
+            if (id==0){ ckpt_write(&ck, &q); free(ck.ring); }
+            rl_free(&ck.prev);
+        }
+        wq_free(&q);
+        sched_free(&sched);
+        free(E.fl_c); free(E.fl_left);
 
-        if (id==0){
+        f_local = E.found;
+        found_local = E.key;
+        for (int t=0;t<threads;t++){
+            if (kern) bs_ctx_free(&W[t].bs);
+            free(W[t].S.bin); free(W[t].S.bhit); free(W[t].tc.pt);
+            pthread_mutex_destroy(&E.dq[t].m);
+        }
+        pthread_mutex_destroy(&E.mpi_lock);
+        TopN best;
+        memset(&best, 0, sizeof(best));
+        if (top > 0){
+            top_init(&best, top);
+            for (int t=0;t<threads;t++){
+                for (int i=0;i<W[t].top.n;i++) top_add(&best, W[t].top.c[i].key, W[t].top.c[i].score);
+                top_free(&W[t].top);
+            }
+        }
+        free(W); free(E.dq); free(th); free(cpus);
+
+        // única colectiva de la búsqueda: juntar el resultado
+        MPI_Allreduce(&f_local,&f_global,1,MPI_INT,MPI_MAX,MPI_COMM_WORLD);
+        MPI_Allreduce(&found_local,&found_global,1,MPI_UNSIGNED_LONG_LONG,MPI_MAX,MPI_COMM_WORLD);
+        if (kpa) kpa_ctx_free(&kc);
+        if (tc.ac) ac_free(&ac);
+        crib_list_free(&cl);
+
+        if (top > 0){
+            // los mejores de cada rank a rank 0 (huecos con score -1)
+            for (int i=best.n;i<top;i++){ best.c[i].key = 0; best.c[i].score = -1.0; }
+            Cand* all = NULL;
+            if (id==0){
+                all = (Cand*)malloc(sizeof(Cand) * (size_t)top * (size_t)N);
+                if (!all) die("mem");
+            }
+            MPI_Gather(best.c, (int)(sizeof(Cand) * (size_t)top), MPI_BYTE,
+                       all, (int)(sizeof(Cand) * (size_t)top), MPI_BYTE, 0, MPI_COMM_WORLD);
+            if (id==0){
+                best.n = 0;
+                for (int i=0;i<top*N;i++) if (all[i].score >= 0) top_add(&best, all[i].key, all[i].score);
+                unsigned char plain[48];
+                int m = ctn < 48 ? ctn : 48;
+                for (int i=0;i<best.n;i++){
+                    DES_key_schedule ks;
+                    tirpc_key_schedule(best.c[i].key, &ks);
+                    for (int j=0;j<m;j+=BLK) try_block(tc.cc, &ks, ct, j, plain + j);
+                    for (int j=0;j<m;j++) if (plain[j] < 0x20 || plain[j] > 0x7E) plain[j] = '.';
+                    printf("RANK %d: %llu score=%.3f | %.*s\n", i+1, (unsigned long long)best.c[i].key,
+                           best.c[i].score, m, (const char*)plain);
+                }
+                free(all);
+                // el mejor se imprime como en el modo normal
+                if (best.n){ f_global = 1; found_global = best.c[0].key; }
+            }
+            top_free(&best);
+        }
+
+        if (batch){
+            if (id==0){
+                int nf = 0;
+                for (int i=0;i<B.n;i++){
+                    BatchItem* it = &B.it[i];
+                    if (!E.bglob[i]){
+                        printf("[%d] %s: No se encontro clave en 2^%d\n", i, it->name, bits);
+                        continue;
+                    }
+                    uint64_t k = E.bglob[i] - 1;
+                    decrypt_des(k, it->ct, it->len);
+                    printf("[%d] %s: FOUND_KEY: %llu\n", i, it->name, (unsigned long long)k);
+                    fwrite(it->ct,1,it->len,stdout); printf("\n");
+                    nf++;
+                }
+                printf("batch: %d/%d resueltas\n", nf, B.n);
+            }
+            free(E.bpub); free(E.bglob);
+            batch_free(&B);
+        } else if (id==0){
             if (f_global){
-                unsigned char* plain=(unsigned char*)malloc(n);
-                if(!plain) die("mem");
-                memcpy(plain, buf, n);
-                decrypt_des(found_global, plain, n);
                 printf("FOUND_KEY: %llu\n", (unsigned long long)found_global);
-                fwrite(plain,1,n,stdout); printf("\n");
-                free(plain);
+                des_stream(found_global, use_cc ? &cc : NULL, &body, body_n, 0, stdout, 0);   // entero, desde el mmap
+                printf("\n");
             } else {
                 printf("No se encontro clave en 2^%d\n", bits);
             }
         }
-        free(buf); MPI_Finalize(); return 0;
+        free(rbuf); input_close(&in); MPI_Finalize(); return 0;
     }
 
     if (id==0) fprintf(stderr,"Modo desconocido\n");
-    free(buf); MPI_Finalize(); return 1;
+    input_close(&in); MPI_Finalize(); return 1;
 }
+#endif // BRUTEFORCE_NO_MAIN
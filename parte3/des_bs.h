@@ -0,0 +1,200 @@
+// des_bs.h — Motor DES bitslice para -mode brute (64/128/256/512 claves por pasada)
+//
+// Cada bit de un vector es una "lane" y cada lane prueba una clave distinta:
+// en una pasada que empieza en 'base' (múltiplo de 64), la lane l prueba la
+// clave TI-RPC base+l. Como el keymap de tirpc_make_key() sólo reparte los 56
+// bits de la clave en los bits altos de cada byte, el key schedule en bitslice
+// es una simple selección de vectores (no hay DES_set_key por clave).
+//
+// La ISA se elige en tiempo de ejecución (u64 / SSE2 / AVX2 / AVX-512). El
+// cuerpo del kernel vive en des_bs_kernel.h y se instancia una vez por ISA.
+//
+// Solo headers: se sigue compilando con  mpicc -O3 -pthread -DOPENSSL_API_COMPAT=0x10100000L bruteforce.c -o bruteforce -lcrypto -lm
+
+#ifndef DES_BS_H
+#define DES_BS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ================ Tablas DES (bits numerados 1..64 desde el MSB) ================
+static const unsigned char DES_IP[64] = {
+    58,50,42,34,26,18,10, 2,  60,52,44,36,28,20,12, 4,
+    62,54,46,38,30,22,14, 6,  64,56,48,40,32,24,16, 8,
+    57,49,41,33,25,17, 9, 1,  59,51,43,35,27,19,11, 3,
+    61,53,45,37,29,21,13, 5,  63,55,47,39,31,23,15, 7
+};
+static const unsigned char DES_E[48] = {
+    32, 1, 2, 3, 4, 5,   4, 5, 6, 7, 8, 9,   8, 9,10,11,12,13,  12,13,14,15,16,17,
+    16,17,18,19,20,21,  20,21,22,23,24,25,  24,25,26,27,28,29,  28,29,30,31,32, 1
+};
+static const unsigned char DES_P[32] = {
+    16, 7,20,21,29,12,28,17,   1,15,23,26, 5,18,31,10,
+     2, 8,24,14,32,27, 3, 9,  19,13,30, 6,22,11, 4,25
+};
+static const unsigned char DES_PC1[56] = {
+    57,49,41,33,25,17, 9,   1,58,50,42,34,26,18,
+    10, 2,59,51,43,35,27,  19,11, 3,60,52,44,36,
+    63,55,47,39,31,23,15,   7,62,54,46,38,30,22,
+    14, 6,61,53,45,37,29,  21,13, 5,28,20,12, 4
+};
+static const unsigned char DES_PC2[48] = {
+    14,17,11,24, 1, 5,   3,28,15, 6,21,10,  23,19,12, 4,26, 8,  16, 7,27,20,13, 2,
+    41,52,31,37,47,55,  30,40,51,45,33,48,  44,49,39,56,34,53,  46,42,50,36,29,32
+};
+static const unsigned char DES_SHIFTS[16] = { 1,1,2,2,2,2,2,2,1,2,2,2,2,2,2,1 };
+
+// Tablas derivadas (bs_tables_init)
+static unsigned char BS_KS[16][48]; // subclave r, bit j -> bit de la clave TI-RPC (0..55)
+static unsigned char BS_FP[64];     // salida j <- preoutput FP[j] (0-based)
+static unsigned char BS_PINV[32];   // salida k de las S-box -> bit de f (0-based)
+static int bs_tables_ready = 0;
+
+// Bit DES n (1..64, sin los de paridad) -> bit de la clave TI-RPC.
+// tirpc_make_key() pone los bits [7i, 7i+6] de la clave en los bits 1..7 del byte i.
+static int bs_des_bit_to_tirpc(int n){
+    int byte = (n-1)/8, b = 7 - (n-1)%8;
+    return (b==0) ? -1 : 7*byte + b - 1;
+}
+
+static void bs_tables_init(void){
+    if (bs_tables_ready) return;
+    unsigned char cd[56];
+    for (int i=0;i<56;i++) cd[i] = (unsigned char)bs_des_bit_to_tirpc(DES_PC1[i]);
+    for (int r=0;r<16;r++){
+        for (int s=0;s<DES_SHIFTS[r];s++){
+            unsigned char c0 = cd[0], d0 = cd[28];
+            memmove(cd, cd+1, 27);    cd[27] = c0;
+            memmove(cd+28, cd+29, 27); cd[55] = d0;
+        }
+        for (int j=0;j<48;j++) BS_KS[r][j] = cd[DES_PC2[j]-1];
+    }
+    for (int j=0;j<64;j++) BS_FP[DES_IP[j]-1] = (unsigned char)j;
+    for (int j=0;j<32;j++) BS_PINV[DES_P[j]-1] = (unsigned char)j;
+    bs_tables_ready = 1;
+}
+
+// ================ Contexto y kernels ================
+typedef struct BsKernel BsKernel;
+
+typedef struct {
+    const BsKernel* kern;
+    const unsigned char* crib;  // bytes del crib (prefiltro memmem)
+    int crib_len;
+    int nring;                  // bloques de texto plano que se mantienen en el anillo
+    void* ring;                 // nring*64 vectores, alineado a 64
+} BsCtx;
+
+// Una entrada del modo batch (ciphertext + crib propios)
+typedef struct {
+    const unsigned char* ct;
+    int len;                    // bytes que descifra el kernel
+    const unsigned char* crib;
+    int crib_len;
+    int active;                 // 0: ya resuelta, no se prueba
+} BsInput;
+
+struct BsKernel {
+    const char* name;
+    int lanes;
+    // Prueba las claves [base, base+lanes). Deja en hit[] (lanes/64 palabras) las lanes
+    // cuyo texto plano contiene el crib en algún offset. Devuelve !=0 si hubo alguna.
+    int (*try_keys)(BsCtx* bs, uint64_t base, const unsigned char* ct, int len, uint64_t* hit);
+    // Igual para n entradas con las mismas claves: hit[i*BS_MAX_WORDS ..] por entrada.
+    // Devuelve cuántas entradas tuvieron alguna lane. El anillo debe alcanzar al crib más largo.
+    int (*try_batch)(BsCtx* bs, uint64_t base, const BsInput* in, int n, uint64_t* hit);
+};
+
+#define BS_MAX_WORDS 8   // palabras de 64 bits por pasada en el kernel más ancho
+
+// Patrones de las lanes dentro de una palabra de 64 (bit t de la clave, t<6)
+static const uint64_t BS_LANE_PAT[6] = {
+    0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+};
+
+// ---- Instancias del kernel (vector extensions de GCC/Clang) ----
+typedef uint64_t bs_v64  __attribute__((vector_size(8)));
+
+#define BS_T     bs_v64
+#define BS_W     1
+#define BS_FN(x) x##_u64
+#define BS_ATTR
+#include "des_bs_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BS_HAVE_X86 1
+typedef uint64_t bs_v128 __attribute__((vector_size(16)));
+typedef uint64_t bs_v256 __attribute__((vector_size(32)));
+typedef uint64_t bs_v512 __attribute__((vector_size(64)));
+
+#define BS_T     bs_v128
+#define BS_W     2
+#define BS_FN(x) x##_sse2
+#define BS_ATTR  __attribute__((target("sse2")))
+#include "des_bs_kernel.h"
+
+#define BS_T     bs_v256
+#define BS_W     4
+#define BS_FN(x) x##_avx2
+#define BS_ATTR  __attribute__((target("avx2")))
+#include "des_bs_kernel.h"
+
+#define BS_T     bs_v512
+#define BS_W     8
+#define BS_FN(x) x##_avx512
+#define BS_ATTR  __attribute__((target("avx512f")))
+#include "des_bs_kernel.h"
+#endif
+
+static const BsKernel BS_KERNELS[] = {
+#ifdef BS_HAVE_X86
+    { "avx512", 512, bs_try_keys_avx512, bs_try_batch_avx512 },
+    { "avx2",   256, bs_try_keys_avx2,   bs_try_batch_avx2 },
+    { "sse2",   128, bs_try_keys_sse2,   bs_try_batch_sse2 },
+#endif
+    { "u64",     64, bs_try_keys_u64,    bs_try_batch_u64 },
+};
+
+static int bs_kernel_supported(const BsKernel* k){
+#ifdef BS_HAVE_X86
+    __builtin_cpu_init();
+    if (!strcmp(k->name,"avx512")) return __builtin_cpu_supports("avx512f");
+    if (!strcmp(k->name,"avx2"))   return __builtin_cpu_supports("avx2");
+    if (!strcmp(k->name,"sse2"))   return __builtin_cpu_supports("sse2");
+#endif
+    (void)k;
+    return 1;
+}
+
+// name NULL o "auto": el más ancho que soporte la CPU. Devuelve NULL si no existe/no se soporta.
+static const BsKernel* bs_select(const char* name){
+    int nk = (int)(sizeof(BS_KERNELS)/sizeof(BS_KERNELS[0]));
+    for (int i=0;i<nk;i++){
+        const BsKernel* k = &BS_KERNELS[i];
+        if (name && strcmp(name,"auto") && strcmp(name,k->name)) continue;
+        if (bs_kernel_supported(k)) return k;
+        if (name && strcmp(name,"auto")) return NULL;
+    }
+    return NULL;
+}
+
+static int bs_ctx_init(BsCtx* bs, const BsKernel* kern, const unsigned char* crib, int crib_len){
+    bs_tables_init();
+    memset(bs, 0, sizeof(*bs));
+    bs->kern = kern;
+    bs->crib = crib;
+    bs->crib_len = crib_len;
+    bs->nring = (crib_len-1)/8 + 2;
+    size_t sz = (size_t)bs->nring * 64 * (size_t)(kern->lanes/8);
+    bs->ring = aligned_alloc(64, (sz + 63) & ~(size_t)63);
+    return bs->ring != NULL;
+}
+
+static void bs_ctx_free(BsCtx* bs){
+    free(bs->ring);
+    bs->ring = NULL;
+}
+
+#endif // DES_BS_H
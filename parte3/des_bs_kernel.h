@@ -0,0 +1,871 @@
+// des_bs_kernel.h — cuerpo del kernel DES bitslice, se incluye una vez por ISA
+// desde des_bs.h con BS_T (tipo vector), BS_W (palabras de 64 bits), BS_FN(x)
+// (sufijo de nombres) y BS_ATTR (atributo target) definidos.
+//
+// S-boxes: circuitos AND/OR/XOR/NOT derivados de las tablas de FIPS 46-3
+// (descomposición de Shannon compartida entre las 4 salidas, ~87 puertas por
+// S-box). Entradas a1..a6 en el orden de E (a1 = MSB), salidas o1..o4 (o1 = MSB)
+// se acumulan con XOR sobre la mitad izquierda.
+
+static inline BS_ATTR void BS_FN(s1)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = ~a6;
+    BS_T x1 = x0 | a2;
+    BS_T x2 = ~a2;
+    BS_T x3 = x2 & a5;
+    BS_T x4 = x1 ^ x3;
+    BS_T x5 = a6 | a2;
+    BS_T x6 = x5 ^ x3;
+    BS_T x7 = x6 & a3;
+    BS_T x8 = x4 ^ x7;
+    BS_T x9 = a6 | ~a2;
+    BS_T x10 = x1 & a5;
+    BS_T x11 = x9 ^ x10;
+    BS_T x12 = ~x5;
+    BS_T x13 = x12 & a3;
+    BS_T x14 = x11 ^ x13;
+    BS_T x15 = x14 & a4;
+    BS_T x16 = x8 ^ x15;
+    BS_T x17 = ~x9;
+    BS_T x18 = x17 & ~a5;
+    BS_T x19 = x18 & a3;
+    BS_T x20 = x11 ^ x19;
+    BS_T x21 = a6 & a5;
+    BS_T x22 = x9 ^ x21;
+    BS_T x23 = x22 & a3;
+    BS_T x24 = x18 ^ x23;
+    BS_T x25 = x24 & a4;
+    BS_T x26 = x20 ^ x25;
+    BS_T x27 = x26 & a1;
+    BS_T x28 = x16 ^ x27;
+    BS_T x29 = a6 ^ a2;
+    BS_T x30 = x29 & a5;
+    BS_T x31 = x17 ^ x30;
+    BS_T x32 = a6 & a2;
+    BS_T x33 = x32 | a5;
+    BS_T x34 = x33 & a3;
+    BS_T x35 = x31 ^ x34;
+    BS_T x36 = ~x32;
+    BS_T x37 = a2 & a5;
+    BS_T x38 = x36 ^ x37;
+    BS_T x39 = x38 & a4;
+    BS_T x40 = x35 ^ x39;
+    BS_T x41 = x12 & a5;
+    BS_T x42 = a6 ^ x41;
+    BS_T x43 = x36 & a5;
+    BS_T x44 = x2 ^ x43;
+    BS_T x45 = x44 & a3;
+    BS_T x46 = x42 ^ x45;
+    BS_T x47 = x0 ^ x3;
+    BS_T x48 = x0 & a5;
+    BS_T x49 = x12 ^ x48;
+    BS_T x50 = x49 & a3;
+    BS_T x51 = x47 ^ x50;
+    BS_T x52 = x51 & a4;
+    BS_T x53 = x46 ^ x52;
+    BS_T x54 = x53 & a1;
+    BS_T x55 = x40 ^ x54;
+    BS_T x56 = ~x29;
+    BS_T x57 = x56 ^ a5;
+    BS_T x58 = x2 & a3;
+    BS_T x59 = x57 ^ x58;
+    BS_T x60 = x57 & a3;
+    BS_T x61 = x21 ^ x60;
+    BS_T x62 = x61 & a4;
+    BS_T x63 = x59 ^ x62;
+    BS_T x64 = ~x43;
+    BS_T x65 = ~x44;
+    BS_T x66 = x65 & a3;
+    BS_T x67 = x64 ^ x66;
+    BS_T x68 = x12 ^ x37;
+    BS_T x69 = x12 ^ a5;
+    BS_T x70 = x69 & a3;
+    BS_T x71 = x68 ^ x70;
+    BS_T x72 = x71 & a4;
+    BS_T x73 = x67 ^ x72;
+    BS_T x74 = x73 & a1;
+    BS_T x75 = x63 ^ x74;
+    BS_T x76 = x12 ^ x21;
+    BS_T x77 = x36 ^ x48;
+    BS_T x78 = x77 & a3;
+    BS_T x79 = x76 ^ x78;
+    BS_T x80 = a6 & ~a5;
+    BS_T x81 = x80 & a3;
+    BS_T x82 = x6 ^ x81;
+    BS_T x83 = x82 & a4;
+    BS_T x84 = x79 ^ x83;
+    BS_T x85 = x5 & a5;
+    BS_T x86 = x9 ^ x85;
+    BS_T x87 = x86 & a3;
+    BS_T x88 = x6 ^ x87;
+    BS_T x89 = x43 ^ x23;
+    BS_T x90 = x89 & a4;
+    BS_T x91 = x88 ^ x90;
+    BS_T x92 = x91 & a1;
+    BS_T x93 = x84 ^ x92;
+    *o1 ^= x75;
+    *o2 ^= x93;
+    *o3 ^= x28;
+    *o4 ^= x55;
+}
+
+static inline BS_ATTR void BS_FN(s2)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = ~a2;
+    BS_T x1 = ~a3;
+    BS_T x2 = x1 & a4;
+    BS_T x3 = x0 ^ x2;
+    BS_T x4 = x1 | a4;
+    BS_T x5 = x4 & a5;
+    BS_T x6 = x3 ^ x5;
+    BS_T x7 = a2 & a3;
+    BS_T x8 = a2 ^ a3;
+    BS_T x9 = x8 & a4;
+    BS_T x10 = x7 ^ x9;
+    BS_T x11 = a2 & ~a4;
+    BS_T x12 = x11 & a5;
+    BS_T x13 = x10 ^ x12;
+    BS_T x14 = x13 & a6;
+    BS_T x15 = x6 ^ x14;
+    BS_T x16 = x0 & ~a3;
+    BS_T x17 = x16 | a4;
+    BS_T x18 = ~x16;
+    BS_T x19 = x18 ^ x2;
+    BS_T x20 = x19 & a5;
+    BS_T x21 = x17 ^ x20;
+    BS_T x22 = a2 ^ x9;
+    BS_T x23 = ~x7;
+    BS_T x24 = a2 & a4;
+    BS_T x25 = x23 ^ x24;
+    BS_T x26 = x25 & a5;
+    BS_T x27 = x22 ^ x26;
+    BS_T x28 = x27 & a6;
+    BS_T x29 = x21 ^ x28;
+    BS_T x30 = x29 & a1;
+    BS_T x31 = x15 ^ x30;
+    BS_T x32 = x0 | a3;
+    BS_T x33 = x0 & a4;
+    BS_T x34 = x32 ^ x33;
+    BS_T x35 = x34 ^ a5;
+    BS_T x36 = x1 ^ x24;
+    BS_T x37 = x2 & a5;
+    BS_T x38 = x36 ^ x37;
+    BS_T x39 = x38 & a6;
+    BS_T x40 = x35 ^ x39;
+    BS_T x41 = x25 | ~a5;
+    BS_T x42 = x41 | a6;
+    BS_T x43 = x42 & a1;
+    BS_T x44 = x40 ^ x43;
+    BS_T x45 = x1 ^ a4;
+    BS_T x46 = x0 & a3;
+    BS_T x47 = x46 ^ x24;
+    BS_T x48 = x47 & a5;
+    BS_T x49 = x45 ^ x48;
+    BS_T x50 = x7 ^ x33;
+    BS_T x51 = x50 & a5;
+    BS_T x52 = x8 ^ x51;
+    BS_T x53 = x52 & a6;
+    BS_T x54 = x49 ^ x53;
+    BS_T x55 = ~x8;
+    BS_T x56 = x55 | a5;
+    BS_T x57 = ~x47;
+    BS_T x58 = x16 ^ a4;
+    BS_T x59 = x58 & a5;
+    BS_T x60 = x57 ^ x59;
+    BS_T x61 = x60 & a6;
+    BS_T x62 = x56 ^ x61;
+    BS_T x63 = x62 & a1;
+    BS_T x64 = x54 ^ x63;
+    BS_T x65 = ~x33;
+    BS_T x66 = x65 & a5;
+    BS_T x67 = x57 ^ x66;
+    BS_T x68 = x32 & a6;
+    BS_T x69 = x67 ^ x68;
+    BS_T x70 = x33 & a5;
+    BS_T x71 = x23 ^ x70;
+    BS_T x72 = ~x32;
+    BS_T x73 = x55 ^ x33;
+    BS_T x74 = x73 & a5;
+    BS_T x75 = x72 ^ x74;
+    BS_T x76 = x75 & a6;
+    BS_T x77 = x71 ^ x76;
+    BS_T x78 = x77 & a1;
+    BS_T x79 = x69 ^ x78;
+    *o1 ^= x79;
+    *o2 ^= x44;
+    *o3 ^= x31;
+    *o4 ^= x64;
+}
+
+static inline BS_ATTR void BS_FN(s3)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = a3 ^ a1;
+    BS_T x1 = x0 ^ a6;
+    BS_T x2 = a3 & a5;
+    BS_T x3 = x1 ^ x2;
+    BS_T x4 = ~a3;
+    BS_T x5 = x4 & a1;
+    BS_T x6 = x5 | ~a6;
+    BS_T x7 = x6 & a5;
+    BS_T x8 = a6 ^ x7;
+    BS_T x9 = x8 & a4;
+    BS_T x10 = x3 ^ x9;
+    BS_T x11 = a3 | a1;
+    BS_T x12 = x11 | a6;
+    BS_T x13 = x12 | a5;
+    BS_T x14 = ~x11;
+    BS_T x15 = x14 ^ a6;
+    BS_T x16 = x15 & a4;
+    BS_T x17 = x13 ^ x16;
+    BS_T x18 = x17 & a2;
+    BS_T x19 = x10 ^ x18;
+    BS_T x20 = x4 | a1;
+    BS_T x21 = a1 & a6;
+    BS_T x22 = x20 ^ x21;
+    BS_T x23 = a3 & a1;
+    BS_T x24 = x23 & a6;
+    BS_T x25 = x4 ^ x24;
+    BS_T x26 = x25 & a5;
+    BS_T x27 = x22 ^ x26;
+    BS_T x28 = ~a1;
+    BS_T x29 = x28 & a6;
+    BS_T x30 = x11 ^ x29;
+    BS_T x31 = x14 & a6;
+    BS_T x32 = x28 ^ x31;
+    BS_T x33 = x32 & a5;
+    BS_T x34 = x30 ^ x33;
+    BS_T x35 = x34 & a4;
+    BS_T x36 = x27 ^ x35;
+    BS_T x37 = ~x5;
+    BS_T x38 = a3 & ~a6;
+    BS_T x39 = x38 & a5;
+    BS_T x40 = x37 ^ x39;
+    BS_T x41 = x28 & ~a6;
+    BS_T x42 = x41 & a5;
+    BS_T x43 = x14 ^ x42;
+    BS_T x44 = x43 & a4;
+    BS_T x45 = x40 ^ x44;
+    BS_T x46 = x45 & a2;
+    BS_T x47 = x36 ^ x46;
+    BS_T x48 = ~x0;
+    BS_T x49 = x48 & a6;
+    BS_T x50 = x28 ^ x49;
+    BS_T x51 = x20 | a6;
+    BS_T x52 = x51 & a5;
+    BS_T x53 = x50 ^ x52;
+    BS_T x54 = x48 ^ x31;
+    BS_T x55 = x54 | a5;
+    BS_T x56 = x55 & a4;
+    BS_T x57 = x53 ^ x56;
+    BS_T x58 = x0 & a6;
+    BS_T x59 = x4 ^ x58;
+    BS_T x60 = x59 ^ x42;
+    BS_T x61 = x14 | a6;
+    BS_T x62 = ~x21;
+    BS_T x63 = x62 & a5;
+    BS_T x64 = x61 ^ x63;
+    BS_T x65 = x64 & a4;
+    BS_T x66 = x60 ^ x65;
+    BS_T x67 = x66 & a2;
+    BS_T x68 = x57 ^ x67;
+    BS_T x69 = x5 ^ x29;
+    BS_T x70 = x11 & a5;
+    BS_T x71 = x69 ^ x70;
+    BS_T x72 = x28 & a5;
+    BS_T x73 = x62 ^ x72;
+    BS_T x74 = x73 & a4;
+    BS_T x75 = x71 ^ x74;
+    BS_T x76 = x37 | a6;
+    BS_T x77 = x5 ^ x21;
+    BS_T x78 = x77 & a5;
+    BS_T x79 = x76 ^ x78;
+    BS_T x80 = x24 & a4;
+    BS_T x81 = x79 ^ x80;
+    BS_T x82 = x81 & a2;
+    BS_T x83 = x75 ^ x82;
+    *o1 ^= x47;
+    *o2 ^= x19;
+    *o3 ^= x68;
+    *o4 ^= x83;
+}
+
+static inline BS_ATTR void BS_FN(s4)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = ~a3;
+    BS_T x1 = a5 | ~a3;
+    BS_T x2 = x1 & a1;
+    BS_T x3 = x0 ^ x2;
+    BS_T x4 = ~a5;
+    BS_T x5 = x4 & a4;
+    BS_T x6 = x3 ^ x5;
+    BS_T x7 = a5 ^ a3;
+    BS_T x8 = x7 | a1;
+    BS_T x9 = ~x7;
+    BS_T x10 = x9 & a1;
+    BS_T x11 = a5 ^ x10;
+    BS_T x12 = x11 & a4;
+    BS_T x13 = x8 ^ x12;
+    BS_T x14 = x13 & a2;
+    BS_T x15 = x6 ^ x14;
+    BS_T x16 = x4 | ~a3;
+    BS_T x17 = x4 | a3;
+    BS_T x18 = x17 & a1;
+    BS_T x19 = x16 ^ x18;
+    BS_T x20 = x19 & a4;
+    BS_T x21 = x11 ^ x20;
+    BS_T x22 = ~x1;
+    BS_T x23 = x22 & a1;
+    BS_T x24 = x9 ^ x23;
+    BS_T x25 = x7 & a4;
+    BS_T x26 = x24 ^ x25;
+    BS_T x27 = x26 & a2;
+    BS_T x28 = x21 ^ x27;
+    BS_T x29 = x28 & a6;
+    BS_T x30 = x15 ^ x29;
+    BS_T x31 = ~x17;
+    BS_T x32 = x31 ^ a1;
+    BS_T x33 = ~x2;
+    BS_T x34 = x33 & a4;
+    BS_T x35 = x32 ^ x34;
+    BS_T x36 = a5 | a3;
+    BS_T x37 = x31 & a1;
+    BS_T x38 = x36 ^ x37;
+    BS_T x39 = x38 ^ x12;
+    BS_T x40 = x39 & a2;
+    BS_T x41 = x35 ^ x40;
+    BS_T x42 = x9 ^ x37;
+    BS_T x43 = x4 ^ x2;
+    BS_T x44 = x43 & a4;
+    BS_T x45 = x42 ^ x44;
+    BS_T x46 = x17 | a1;
+    BS_T x47 = x46 ^ x25;
+    BS_T x48 = x47 & a2;
+    BS_T x49 = x45 ^ x48;
+    BS_T x50 = x49 & a6;
+    BS_T x51 = x41 ^ x50;
+    BS_T x52 = x1 ^ x18;
+    BS_T x53 = a5 & a4;
+    BS_T x54 = x52 ^ x53;
+    BS_T x55 = a3 ^ x10;
+    BS_T x56 = x55 & a4;
+    BS_T x57 = x0 ^ x56;
+    BS_T x58 = x57 & a2;
+    BS_T x59 = x54 ^ x58;
+    BS_T x60 = ~x49;
+    BS_T x61 = x60 & a6;
+    BS_T x62 = x59 ^ x61;
+    BS_T x63 = x31 | a1;
+    BS_T x64 = x63 & a4;
+    BS_T x65 = x42 ^ x64;
+    BS_T x66 = ~x18;
+    BS_T x67 = x66 ^ x56;
+    BS_T x68 = x67 & a2;
+    BS_T x69 = x65 ^ x68;
+    BS_T x70 = ~x28;
+    BS_T x71 = x70 & a6;
+    BS_T x72 = x69 ^ x71;
+    *o1 ^= x51;
+    *o2 ^= x62;
+    *o3 ^= x72;
+    *o4 ^= x30;
+}
+
+static inline BS_ATTR void BS_FN(s5)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = ~a6;
+    BS_T x1 = x0 | a4;
+    BS_T x2 = x1 & a3;
+    BS_T x3 = a6 | a4;
+    BS_T x4 = x3 & a2;
+    BS_T x5 = x2 ^ x4;
+    BS_T x6 = a6 ^ a4;
+    BS_T x7 = ~x3;
+    BS_T x8 = x7 & a3;
+    BS_T x9 = x6 ^ x8;
+    BS_T x10 = x1 ^ a3;
+    BS_T x11 = x10 & a2;
+    BS_T x12 = x9 ^ x11;
+    BS_T x13 = x12 & a5;
+    BS_T x14 = x5 ^ x13;
+    BS_T x15 = x6 ^ x2;
+    BS_T x16 = ~x6;
+    BS_T x17 = x16 & ~a3;
+    BS_T x18 = x17 & a2;
+    BS_T x19 = x15 ^ x18;
+    BS_T x20 = x0 & a4;
+    BS_T x21 = x20 & a3;
+    BS_T x22 = a4 ^ x21;
+    BS_T x23 = x0 & a3;
+    BS_T x24 = x16 ^ x23;
+    BS_T x25 = x24 & a2;
+    BS_T x26 = x22 ^ x25;
+    BS_T x27 = x26 & a5;
+    BS_T x28 = x19 ^ x27;
+    BS_T x29 = x28 & a1;
+    BS_T x30 = x14 ^ x29;
+    BS_T x31 = ~x1;
+    BS_T x32 = x3 & a3;
+    BS_T x33 = x31 ^ x32;
+    BS_T x34 = ~x20;
+    BS_T x35 = a6 & a3;
+    BS_T x36 = x34 ^ x35;
+    BS_T x37 = x36 & a2;
+    BS_T x38 = x33 ^ x37;
+    BS_T x39 = x16 ^ x21;
+    BS_T x40 = a4 ^ x35;
+    BS_T x41 = x40 & a2;
+    BS_T x42 = x39 ^ x41;
+    BS_T x43 = x42 & a5;
+    BS_T x44 = x38 ^ x43;
+    BS_T x45 = a6 & a4;
+    BS_T x46 = x45 ^ x23;
+    BS_T x47 = x6 & a3;
+    BS_T x48 = x20 ^ x47;
+    BS_T x49 = x48 & a2;
+    BS_T x50 = x46 ^ x49;
+    BS_T x51 = x0 ^ x47;
+    BS_T x52 = x51 ^ x4;
+    BS_T x53 = x52 & a5;
+    BS_T x54 = x50 ^ x53;
+    BS_T x55 = x54 & a1;
+    BS_T x56 = x44 ^ x55;
+    BS_T x57 = x31 & a3;
+    BS_T x58 = a4 ^ x57;
+    BS_T x59 = x58 & a2;
+    BS_T x60 = x15 ^ x59;
+    BS_T x61 = ~x57;
+    BS_T x62 = x61 & a5;
+    BS_T x63 = x60 ^ x62;
+    BS_T x64 = x1 ^ x8;
+    BS_T x65 = x64 | ~a2;
+    BS_T x66 = a4 & a3;
+    BS_T x67 = x3 ^ x66;
+    BS_T x68 = x67 & a5;
+    BS_T x69 = x65 ^ x68;
+    BS_T x70 = x69 & a1;
+    BS_T x71 = x63 ^ x70;
+    BS_T x72 = x34 ^ x32;
+    BS_T x73 = ~x45;
+    BS_T x74 = x73 ^ x21;
+    BS_T x75 = x74 & a2;
+    BS_T x76 = x72 ^ x75;
+    BS_T x77 = x34 & a3;
+    BS_T x78 = x16 ^ x77;
+    BS_T x79 = x78 ^ x25;
+    BS_T x80 = x79 & a5;
+    BS_T x81 = x76 ^ x80;
+    BS_T x82 = ~x9;
+    BS_T x83 = ~x78;
+    BS_T x84 = x83 & a2;
+    BS_T x85 = x82 ^ x84;
+    BS_T x86 = x73 ^ x35;
+    BS_T x87 = x86 & a2;
+    BS_T x88 = x83 ^ x87;
+    BS_T x89 = x88 & a5;
+    BS_T x90 = x85 ^ x89;
+    BS_T x91 = x90 & a1;
+    BS_T x92 = x81 ^ x91;
+    *o1 ^= x56;
+    *o2 ^= x71;
+    *o3 ^= x92;
+    *o4 ^= x30;
+}
+
+static inline BS_ATTR void BS_FN(s6)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = a1 & a3;
+    BS_T x1 = x0 ^ a4;
+    BS_T x2 = a1 | a3;
+    BS_T x3 = x2 & a5;
+    BS_T x4 = x1 ^ x3;
+    BS_T x5 = ~a1;
+    BS_T x6 = x5 | a3;
+    BS_T x7 = x5 & a4;
+    BS_T x8 = x0 ^ x7;
+    BS_T x9 = x8 & a5;
+    BS_T x10 = x6 ^ x9;
+    BS_T x11 = x10 & a6;
+    BS_T x12 = x4 ^ x11;
+    BS_T x13 = a3 ^ x7;
+    BS_T x14 = x13 & a5;
+    BS_T x15 = x2 ^ x14;
+    BS_T x16 = ~x0;
+    BS_T x17 = a1 & a4;
+    BS_T x18 = x16 ^ x17;
+    BS_T x19 = x18 & a5;
+    BS_T x20 = x19 & a6;
+    BS_T x21 = x15 ^ x20;
+    BS_T x22 = x21 & a2;
+    BS_T x23 = x12 ^ x22;
+    BS_T x24 = a3 & a4;
+    BS_T x25 = x16 ^ x24;
+    BS_T x26 = ~a3;
+    BS_T x27 = x26 & a4;
+    BS_T x28 = x6 ^ x27;
+    BS_T x29 = x28 & a5;
+    BS_T x30 = x25 ^ x29;
+    BS_T x31 = x5 ^ a3;
+    BS_T x32 = x31 & a4;
+    BS_T x33 = x2 ^ x32;
+    BS_T x34 = x33 | a5;
+    BS_T x35 = x34 & a6;
+    BS_T x36 = x30 ^ x35;
+    BS_T x37 = x2 & a4;
+    BS_T x38 = x0 ^ x37;
+    BS_T x39 = ~x18;
+    BS_T x40 = x39 & a5;
+    BS_T x41 = x38 ^ x40;
+    BS_T x42 = x41 & a6;
+    BS_T x43 = x26 ^ x42;
+    BS_T x44 = x43 & a2;
+    BS_T x45 = x36 ^ x44;
+    BS_T x46 = ~x2;
+    BS_T x47 = x46 ^ a4;
+    BS_T x48 = x26 ^ x37;
+    BS_T x49 = x48 & a5;
+    BS_T x50 = x47 ^ x49;
+    BS_T x51 = x16 ^ x40;
+    BS_T x52 = x51 & a6;
+    BS_T x53 = x50 ^ x52;
+    BS_T x54 = ~x1;
+    BS_T x55 = x54 ^ x40;
+    BS_T x56 = x0 & ~a4;
+    BS_T x57 = x1 & a5;
+    BS_T x58 = x56 ^ x57;
+    BS_T x59 = x58 & a6;
+    BS_T x60 = x55 ^ x59;
+    BS_T x61 = x60 & a2;
+    BS_T x62 = x53 ^ x61;
+    BS_T x63 = ~x31;
+    BS_T x64 = x5 & a3;
+    BS_T x65 = x64 & a4;
+    BS_T x66 = x63 ^ x65;
+    BS_T x67 = ~x38;
+    BS_T x68 = x67 & a5;
+    BS_T x69 = x66 ^ x68;
+    BS_T x70 = a1 ^ x65;
+    BS_T x71 = x46 & a4;
+    BS_T x72 = x71 & a5;
+    BS_T x73 = x70 ^ x72;
+    BS_T x74 = x73 & a6;
+    BS_T x75 = x69 ^ x74;
+    BS_T x76 = a3 | a4;
+    BS_T x77 = ~x6;
+    BS_T x78 = x63 & a4;
+    BS_T x79 = x77 ^ x78;
+    BS_T x80 = x7 & a5;
+    BS_T x81 = x79 ^ x80;
+    BS_T x82 = x81 & a6;
+    BS_T x83 = x76 ^ x82;
+    BS_T x84 = x83 & a2;
+    BS_T x85 = x75 ^ x84;
+    *o1 ^= x45;
+    *o2 ^= x62;
+    *o3 ^= x23;
+    *o4 ^= x85;
+}
+
+static inline BS_ATTR void BS_FN(s7)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = a6 & a1;
+    BS_T x1 = ~a6;
+    BS_T x2 = x1 ^ a1;
+    BS_T x3 = x2 & a3;
+    BS_T x4 = x0 ^ x3;
+    BS_T x5 = x1 & ~a1;
+    BS_T x6 = x1 & a1;
+    BS_T x7 = x6 & a3;
+    BS_T x8 = x5 ^ x7;
+    BS_T x9 = x8 & a5;
+    BS_T x10 = x4 ^ x9;
+    BS_T x11 = x1 | a1;
+    BS_T x12 = x11 | ~a3;
+    BS_T x13 = ~x11;
+    BS_T x14 = x13 & a3;
+    BS_T x15 = x1 ^ x14;
+    BS_T x16 = x15 & a5;
+    BS_T x17 = x12 ^ x16;
+    BS_T x18 = x17 & a4;
+    BS_T x19 = x10 ^ x18;
+    BS_T x20 = ~x7;
+    BS_T x21 = x20 | a5;
+    BS_T x22 = a1 ^ x14;
+    BS_T x23 = x2 & a5;
+    BS_T x24 = x22 ^ x23;
+    BS_T x25 = x24 & a4;
+    BS_T x26 = x21 ^ x25;
+    BS_T x27 = x26 & a2;
+    BS_T x28 = x19 ^ x27;
+    BS_T x29 = ~x0;
+    BS_T x30 = x29 & a3;
+    BS_T x31 = x13 ^ x30;
+    BS_T x32 = ~x6;
+    BS_T x33 = a1 & a3;
+    BS_T x34 = x32 ^ x33;
+    BS_T x35 = x34 & a5;
+    BS_T x36 = x31 ^ x35;
+    BS_T x37 = x5 & a3;
+    BS_T x38 = x0 ^ x37;
+    BS_T x39 = x38 & a5;
+    BS_T x40 = a1 ^ x39;
+    BS_T x41 = x40 & a4;
+    BS_T x42 = x36 ^ x41;
+    BS_T x43 = a1 ^ x37;
+    BS_T x44 = x33 & a5;
+    BS_T x45 = x43 ^ x44;
+    BS_T x46 = ~x43;
+    BS_T x47 = a1 & a5;
+    BS_T x48 = x46 ^ x47;
+    BS_T x49 = x48 & a4;
+    BS_T x50 = x45 ^ x49;
+    BS_T x51 = x50 & a2;
+    BS_T x52 = x42 ^ x51;
+    BS_T x53 = x34 ^ a5;
+    BS_T x54 = ~a1;
+    BS_T x55 = ~x2;
+    BS_T x56 = x55 & a3;
+    BS_T x57 = x56 & a5;
+    BS_T x58 = x54 ^ x57;
+    BS_T x59 = x58 & a4;
+    BS_T x60 = x53 ^ x59;
+    BS_T x61 = x2 ^ x30;
+    BS_T x62 = x29 ^ x33;
+    BS_T x63 = x13 & a5;
+    BS_T x64 = x62 ^ x63;
+    BS_T x65 = x64 & a4;
+    BS_T x66 = x61 ^ x65;
+    BS_T x67 = x66 & a2;
+    BS_T x68 = x60 ^ x67;
+    BS_T x69 = x55 ^ a3;
+    BS_T x70 = x69 ^ a5;
+    BS_T x71 = x0 | a3;
+    BS_T x72 = x71 | a5;
+    BS_T x73 = x72 & a4;
+    BS_T x74 = x70 ^ x73;
+    BS_T x75 = ~x30;
+    BS_T x76 = x0 & a5;
+    BS_T x77 = x75 ^ x76;
+    BS_T x78 = a6 & a5;
+    BS_T x79 = x13 ^ x78;
+    BS_T x80 = x79 & a4;
+    BS_T x81 = x77 ^ x80;
+    BS_T x82 = x81 & a2;
+    BS_T x83 = x74 ^ x82;
+    *o1 ^= x52;
+    *o2 ^= x68;
+    *o3 ^= x28;
+    *o4 ^= x83;
+}
+
+static inline BS_ATTR void BS_FN(s8)(BS_T a1, BS_T a2, BS_T a3, BS_T a4, BS_T a5, BS_T a6,
+                                      BS_T *o1, BS_T *o2, BS_T *o3, BS_T *o4)
+{
+    BS_T x0 = ~a5;
+    BS_T x1 = x0 | a3;
+    BS_T x2 = x1 ^ a4;
+    BS_T x3 = x2 ^ a6;
+    BS_T x4 = x0 ^ a3;
+    BS_T x5 = x0 & a4;
+    BS_T x6 = x4 ^ x5;
+    BS_T x7 = x6 & a2;
+    BS_T x8 = x3 ^ x7;
+    BS_T x9 = x0 & a3;
+    BS_T x10 = ~a3;
+    BS_T x11 = x10 & a4;
+    BS_T x12 = x9 ^ x11;
+    BS_T x13 = ~x1;
+    BS_T x14 = x13 ^ x11;
+    BS_T x15 = x14 & a6;
+    BS_T x16 = x12 ^ x15;
+    BS_T x17 = ~x4;
+    BS_T x18 = x17 | a4;
+    BS_T x19 = a3 & a4;
+    BS_T x20 = x19 & a6;
+    BS_T x21 = x18 ^ x20;
+    BS_T x22 = x21 & a2;
+    BS_T x23 = x16 ^ x22;
+    BS_T x24 = x23 & a1;
+    BS_T x25 = x8 ^ x24;
+    BS_T x26 = a5 | a3;
+    BS_T x27 = a5 & a4;
+    BS_T x28 = x26 ^ x27;
+    BS_T x29 = x18 | ~a6;
+    BS_T x30 = x29 & a2;
+    BS_T x31 = x28 ^ x30;
+    BS_T x32 = x1 ^ x5;
+    BS_T x33 = a5 | a4;
+    BS_T x34 = x33 & a6;
+    BS_T x35 = x32 ^ x34;
+    BS_T x36 = a5 & a3;
+    BS_T x37 = x36 ^ x27;
+    BS_T x38 = x37 & a6;
+    BS_T x39 = x13 ^ x38;
+    BS_T x40 = x39 & a2;
+    BS_T x41 = x35 ^ x40;
+    BS_T x42 = x41 & a1;
+    BS_T x43 = x31 ^ x42;
+    BS_T x44 = x4 ^ x19;
+    BS_T x45 = x17 | ~a4;
+    BS_T x46 = x45 & a6;
+    BS_T x47 = x44 ^ x46;
+    BS_T x48 = x4 & a4;
+    BS_T x49 = a5 ^ x48;
+    BS_T x50 = x0 ^ x11;
+    BS_T x51 = x50 & a6;
+    BS_T x52 = x49 ^ x51;
+    BS_T x53 = x52 & a2;
+    BS_T x54 = x47 ^ x53;
+    BS_T x55 = ~x36;
+    BS_T x56 = x17 & a4;
+    BS_T x57 = x55 ^ x56;
+    BS_T x58 = x4 | a4;
+    BS_T x59 = x58 & a6;
+    BS_T x60 = x57 ^ x59;
+    BS_T x61 = x9 ^ x48;
+    BS_T x62 = x61 & a6;
+    BS_T x63 = x19 ^ x62;
+    BS_T x64 = x63 & a2;
+    BS_T x65 = x60 ^ x64;
+    BS_T x66 = x65 & a1;
+    BS_T x67 = x54 ^ x66;
+    BS_T x68 = ~x9;
+    BS_T x69 = x68 & a4;
+    BS_T x70 = x13 ^ x69;
+    BS_T x71 = x70 & a6;
+    BS_T x72 = x6 ^ x71;
+    BS_T x73 = ~x27;
+    BS_T x74 = x17 & a6;
+    BS_T x75 = x73 ^ x74;
+    BS_T x76 = x75 & a2;
+    BS_T x77 = x72 ^ x76;
+    BS_T x78 = x57 & a6;
+    BS_T x79 = x26 ^ x78;
+    BS_T x80 = x9 ^ x5;
+    BS_T x81 = x80 ^ x15;
+    BS_T x82 = x81 & a2;
+    BS_T x83 = x79 ^ x82;
+    BS_T x84 = x83 & a1;
+    BS_T x85 = x77 ^ x84;
+    *o1 ^= x67;
+    *o2 ^= x25;
+    *o3 ^= x43;
+    *o4 ^= x85;
+}
+// Clave TI-RPC de cada lane -> 56 vectores (uno por bit de la clave)
+static inline BS_ATTR void BS_FN(bs_load_keys)(uint64_t base, BS_T K[56])
+{
+    for (int t=0;t<56;t++){
+        for (int w=0;w<BS_W;w++){
+            uint64_t kw = base + 64u*(uint64_t)w;
+            K[t][w] = (t<6) ? BS_LANE_PAT[t] : (((kw >> t) & 1) ? ~0ULL : 0ULL);
+        }
+    }
+}
+
+// Descifra un bloque (igual para todas las lanes) con la clave de cada lane.
+// P[j] = bit j+1 del texto plano (numeración DES: P[0] es el MSB del byte 0).
+static BS_ATTR void BS_FN(bs_decrypt_block)(const BS_T K[56], const unsigned char ct[8], BS_T P[64])
+{
+    const BS_T zero = (BS_T){0};
+    const BS_T ones = ~zero;
+    BS_T LR[64];
+    for (int j=0;j<64;j++){
+        int n = DES_IP[j]-1;
+        LR[j] = ((ct[n>>3] >> (7-(n&7))) & 1) ? ones : zero;
+    }
+    BS_T *L = LR, *R = LR+32;
+    for (int r=0;r<16;r++){
+        const unsigned char* ks = BS_KS[15-r];  // descifrar: subclaves al revés
+        BS_T x[48];
+        for (int j=0;j<48;j++) x[j] = R[DES_E[j]-1] ^ K[ks[j]];
+        const unsigned char* pv = BS_PINV;
+        BS_FN(s1)(x[ 0],x[ 1],x[ 2],x[ 3],x[ 4],x[ 5], &L[pv[ 0]],&L[pv[ 1]],&L[pv[ 2]],&L[pv[ 3]]);
+        BS_FN(s2)(x[ 6],x[ 7],x[ 8],x[ 9],x[10],x[11], &L[pv[ 4]],&L[pv[ 5]],&L[pv[ 6]],&L[pv[ 7]]);
+        BS_FN(s3)(x[12],x[13],x[14],x[15],x[16],x[17], &L[pv[ 8]],&L[pv[ 9]],&L[pv[10]],&L[pv[11]]);
+        BS_FN(s4)(x[18],x[19],x[20],x[21],x[22],x[23], &L[pv[12]],&L[pv[13]],&L[pv[14]],&L[pv[15]]);
+        BS_FN(s5)(x[24],x[25],x[26],x[27],x[28],x[29], &L[pv[16]],&L[pv[17]],&L[pv[18]],&L[pv[19]]);
+        BS_FN(s6)(x[30],x[31],x[32],x[33],x[34],x[35], &L[pv[20]],&L[pv[21]],&L[pv[22]],&L[pv[23]]);
+        BS_FN(s7)(x[36],x[37],x[38],x[39],x[40],x[41], &L[pv[24]],&L[pv[25]],&L[pv[26]],&L[pv[27]]);
+        BS_FN(s8)(x[42],x[43],x[44],x[45],x[46],x[47], &L[pv[28]],&L[pv[29]],&L[pv[30]],&L[pv[31]]);
+        BS_T* t = L; L = R; R = t;
+    }
+    // tras el último swap L/R son L16/R16; preoutput = R16 || L16
+    for (int j=0;j<64;j++){
+        int n = BS_FP[j];
+        P[j] = (n<32) ? R[n] : L[n-32];
+    }
+}
+
+static inline BS_ATTR int BS_FN(bs_is_zero)(BS_T v)
+{
+    uint64_t acc = 0;
+    for (int w=0;w<BS_W;w++) acc |= v[w];
+    return acc == 0;
+}
+
+// Descifra ct[0..len) con las claves K y marca en hit[] (BS_W palabras) las lanes
+// cuyo texto plano contiene cb[0..clen) en algún offset
+static inline BS_ATTR int BS_FN(bs_match)(const BS_T K[56], BS_T* ring, int nring,
+                                          const unsigned char* ct, int len,
+                                          const unsigned char* cb, int clen, uint64_t* hit)
+{
+    const BS_T zero = (BS_T){0};
+    const BS_T ones = ~zero;
+    BS_T acc = zero;
+
+    for (int b=0; b*8<len; b++){
+        BS_FN(bs_decrypt_block)(K, ct + 8*b, ring + 64*(b % nring));
+
+        // inicios s cuyo último byte cae en este bloque
+        int s_lo = 8*b - clen + 1, s_hi = 8*b + 7 - clen + 1;
+        if (s_lo < 0) s_lo = 0;
+        for (int s=s_lo; s<=s_hi; s++){
+            BS_T m = ones;
+            for (int q=0;q<clen;q++){
+                int p = s+q;
+                const BS_T* pb = ring + 64*((p>>3) % nring) + 8*(p&7);
+                unsigned char c = cb[q];
+                for (int bit=0;bit<8;bit++)
+                    m &= ((c >> (7-bit)) & 1) ? pb[bit] : ~pb[bit];
+                if (BS_FN(bs_is_zero)(m)) break;
+            }
+            acc |= m;
+        }
+    }
+    for (int w=0;w<BS_W;w++) hit[w] = acc[w];
+    return !BS_FN(bs_is_zero)(acc);
+}
+
+static BS_ATTR int BS_FN(bs_try_keys)(BsCtx* bs, uint64_t base, const unsigned char* ct, int len, uint64_t* hit)
+{
+    BS_T K[56];
+    BS_FN(bs_load_keys)(base, K);
+    return BS_FN(bs_match)(K, (BS_T*)bs->ring, bs->nring, ct, len, bs->crib, bs->crib_len, hit);
+}
+
+// Lote: las claves se cargan una vez y se prueban contra todas las entradas activas
+static BS_ATTR int BS_FN(bs_try_batch)(BsCtx* bs, uint64_t base, const BsInput* in, int n, uint64_t* hit)
+{
+    BS_T K[56];
+    int nhit = 0;
+    BS_FN(bs_load_keys)(base, K);
+    for (int i=0;i<n;i++){
+        uint64_t* h = hit + (size_t)i*BS_MAX_WORDS;
+        if (!in[i].active){ for (int w=0;w<BS_W;w++) h[w] = 0; continue; }
+        nhit += BS_FN(bs_match)(K, (BS_T*)bs->ring, bs->nring, in[i].ct, in[i].len,
+                                in[i].crib, in[i].crib_len, h);
+    }
+    return nhit;
+}
+
+#undef BS_T
+#undef BS_W
+#undef BS_FN
+#undef BS_ATTR